@@ -0,0 +1,162 @@
+/**
+ *  @file
+ *  @copyright eosauthority - free to use and modify - see LICENSE.txt
+ *
+ *  Messages per second one core can consume: synthetic binary block frames, spread over shards like a split stream,
+ *  are put back in order with ordered_reassembly in batches and every action is read through the views.
+ */
+#include <eosio/watcher_consumer/reassembly.hpp>
+#include <eosio/watcher_consumer/views.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace {
+   struct options {
+      uint32_t frames = 200000;
+      uint32_t txs = 4;
+      uint32_t actions = 2;
+      uint32_t shards = 2;
+      size_t   batch = 256;
+   };
+
+   /// Packs values the way fc::raw does
+   class packer {
+   public:
+      template<typename T>
+      void pod( T v ) { out.append( reinterpret_cast<const char*>(&v), sizeof(v) ); }
+      void varuint( uint32_t v ) {
+         do {
+            uint8_t b = v & 0x7f;
+            v >>= 7;
+            if( v ) b |= 0x80;
+            out += char(b);
+         } while( v );
+      }
+      void bytes( const std::string& s ) { varuint( s.size() ); out += s; }
+      void checksum( uint32_t seed ) {
+         for( uint32_t i = 0; i < 8; ++i ) pod<uint32_t>( seed * 2654435761u + i );
+      }
+      void variant_string( const std::string& s ) { out += char(eosio::variant_view::string_type); bytes( s ); }
+
+      std::string out;
+   };
+
+   /// A block message with transfer actions whose action_data is an object, as the plugin decodes them
+   std::string make_block_frame( uint32_t block_num, const options& opt ) {
+      using eosio::name_value;
+      packer p;
+      p.pod<uint32_t>( 0 );
+      p.pod<uint32_t>( block_num );
+      p.checksum( block_num );
+      p.checksum( block_num - 1 );
+      p.pod<int64_t>( 1528977600000000ll + block_num * 500000ll );
+      p.pod<uint32_t>( 0 );
+      p.pod<uint64_t>( block_num );    // seq
+      p.pod<uint32_t>( 0 );            // lane
+      p.pod<uint32_t>( 0 );            // degraded
+      p.varuint( opt.txs );
+      for( uint32_t t = 0; t < opt.txs; ++t ) {
+         p.checksum( block_num * 131 + t );
+         p.varuint( opt.actions );
+         for( uint32_t a = 0; a < opt.actions; ++a ) {
+            p.pod( name_value("eosio.token") );
+            p.pod( name_value("transfer") );
+            p.pod<uint64_t>( (uint64_t(block_num) << 16) + t * opt.actions + a );   // global_sequence
+            p.varuint( 1 );
+            p.pod( name_value("eosauthority") );
+            p.pod( name_value("active") );
+            p.out += char(eosio::variant_view::object_type);
+            p.varuint( 4 );
+            p.bytes( "from" );     p.variant_string( "eosauthority" );
+            p.bytes( "to" );       p.variant_string( "chintaitest1" );
+            p.bytes( "quantity" ); p.variant_string( std::to_string(a + 1) + ".0000 EOS" );
+            p.bytes( "memo" );     p.variant_string( "bench" );
+            p.out += char(0);      // no packed data
+            p.out += char(0);      // no abi_sequence
+         }
+      }
+      return p.out;
+   }
+
+   struct frame_ref {
+      const std::string* bytes;
+   };
+}
+
+int main( int argc, char** argv ) {
+   using namespace eosio;
+   options opt;
+   try {
+      for( int i = 1; i + 1 < argc; i += 2 ) {
+         const std::string arg = argv[i];
+         const unsigned long value = std::stoul( argv[i + 1] );
+         if( arg == "--frames" ) opt.frames = value;
+         else if( arg == "--txs" ) opt.txs = value;
+         else if( arg == "--actions" ) opt.actions = value;
+         else if( arg == "--shards" ) opt.shards = std::max<unsigned long>( 1, value );
+         else if( arg == "--batch" ) opt.batch = std::max<unsigned long>( 1, value );
+         else throw std::invalid_argument( "unknown option " + arg );
+      }
+      if( argc % 2 == 0 ) throw std::invalid_argument( "options take a value" );
+   } catch( const std::exception& e ) {
+      std::cerr << "watcher_consumer_bench: " << e.what() << "\n"
+                << "Usage: watcher_consumer_bench [--frames N] [--txs N] [--actions N] [--shards N] [--batch N]\n";
+      return 1;
+   }
+
+   // Built up front so only consuming is timed
+   std::vector<std::string> frames;
+   frames.reserve( opt.frames );
+   uint64_t bytes = 0;
+   for( uint32_t n = 0; n < opt.frames; ++n ) {
+      frames.push_back( make_block_frame(n + 1, opt) );
+      bytes += frames.back().size();
+   }
+
+   ordered_reassembly<frame_ref> reassembly( opt.shards );
+   std::vector<frame_ref> batch;
+   batch.reserve( opt.batch );
+   const uint64_t token = name_value( "eosio.token" );
+   uint64_t actions = 0, quantity_bytes = 0, last_block = 0, out_of_order = 0;
+
+   auto consume = [&]() {
+      for( const auto& ref : batch ) {
+         const auto block = block_message_view::parse( ref.bytes->data(), ref.bytes->size() );
+         if( block.header.block_num < last_block ) ++out_of_order;
+         last_block = block.header.block_num;
+         for( const auto& tx : block.transactions ) {
+            for( const auto& act : tx.actions ) {
+               if( act.account != token ) continue;
+               ++actions;
+               quantity_bytes += act.action_data.find( "quantity" ).as_string().size;
+            }
+         }
+      }
+      batch.clear();
+   };
+   auto take = [&]( frame_ref&& f ) {
+      batch.push_back( f );
+      if( batch.size() == opt.batch ) consume();
+   };
+
+   const auto start = std::chrono::steady_clock::now();
+   // Frames arrive round robin over the shards, each shard in order
+   for( uint32_t n = 0; n < opt.frames; ++n ) {
+      reassembly.push( n % opt.shards, n + 1, frame_ref{ &frames[n] } );
+      if( reassembly.size() >= opt.batch ) reassembly.drain( take );
+   }
+   reassembly.flush( take );
+   consume();
+   const double secs = std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+
+   printf( "%u frames of %zu bytes (%u txs x %u actions) over %u shards, batches of %zu\n",
+           opt.frames, frames.empty() ? size_t(0) : frames[0].size(), opt.txs, opt.actions, opt.shards, opt.batch );
+   printf( "%.0f messages/s, %.0f actions/s, %.1f MB/s on one core\n",
+           opt.frames / secs, actions / secs, bytes / secs / 1e6 );
+   if( out_of_order || quantity_bytes == 0 ) printf( "unexpected: %llu frames out of order\n", (unsigned long long)out_of_order );
+   return 0;
+}
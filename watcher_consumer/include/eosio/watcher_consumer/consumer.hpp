@@ -0,0 +1,190 @@
+/**
+ *  @file
+ *  @copyright eosauthority - free to use and modify - see LICENSE.txt
+ */
+#pragma once
+#include <eosio/watcher_consumer/reassembly.hpp>
+#include <eosio/watcher_consumer/views.hpp>
+#include <eosio/watcher_relay/frame.hpp>
+
+#include <zmq.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace eosio {
+
+   /**
+    * Reads the plugin's stream from one or more PULL sockets and hands it to a callback in batches, in block order
+    * across the sockets (see ordered_reassembly).
+    *
+    * Frames are passed as received: the callback reads binary frames in place through views, which stay valid until it
+    * returns. zlib frames are inflated first and handed over as json.
+    *
+    *    watcher_consumer consumer( context, cfg );
+    *    consumer.run( done, []( const std::vector<watcher_consumer::frame>& batch ) {
+    *       for( const auto& f : batch ) {
+    *          if( f.info.msg_type != 0 ) continue;
+    *          for( const auto& tx : f.block().transactions )
+    *             for( const auto& act : tx.actions ) ...
+    *       }
+    *    } );
+    */
+   class watcher_consumer {
+   public:
+      struct config {
+         std::vector<std::string>  endpoints;                     // connected in order, frames of one block keep it
+         frame_encoding            encoding = frame_encoding::binary;
+         size_t                    max_batch = 256;
+         std::chrono::milliseconds stall = std::chrono::milliseconds(1000);
+      };
+
+      struct frame {
+         frame_info  info;          // header, see frame.hpp
+         const char* data = nullptr;
+         size_t      size = 0;
+         size_t      shard = 0;     // index of the endpoint it arrived on
+
+         // Binary frames only
+         block_message_view block()const { return block_message_view::parse( data, size ); }
+         irreversible_message_view irreversible()const { return irreversible_message_view::parse( data, size ); }
+         table_delta_message_view table_deltas()const { return table_delta_message_view::parse( data, size ); }
+         aggregate_message_view aggregate()const { return aggregate_message_view::parse( data, size ); }
+         abi_message_view abi()const { return abi_message_view::parse( data, size ); }
+      };
+
+      struct stats {
+         uint64_t frames = 0;
+         uint64_t batches = 0;
+         uint64_t malformed = 0;
+      };
+
+      watcher_consumer( zmq::context_t& context, const config& c )
+      : cfg(c), reassembly(c.endpoints.size(), c.stall) {
+         int linger = 0;
+         for( const auto& address : cfg.endpoints ) {
+            sockets.emplace_back( new zmq::socket_t(context, ZMQ_PULL) );
+            sockets.back()->setsockopt( ZMQ_LINGER, &linger, sizeof(linger) );
+            sockets.back()->connect( address );
+            items.push_back( { static_cast<void*>(*sockets.back()), 0, ZMQ_POLLIN, 0 } );
+         }
+      }
+
+      watcher_consumer( const watcher_consumer& ) = delete;
+      watcher_consumer& operator=( const watcher_consumer& ) = delete;
+
+      /// Calls @ref on_batch with batches of frames until @ref done is set; what is still queued is delivered then
+      template<typename Callback>
+      void run( const std::atomic<bool>& done, Callback&& on_batch ) {
+         const long timeout = std::min<long>( 100, std::max<long>(1, cfg.stall.count()) );
+         while( !done ) {
+            zmq::poll( items.data(), items.size(), reassembly.size() ? timeout : 100 );
+            receive();
+            deliver( on_batch, false );
+         }
+         deliver( on_batch, true );
+      }
+
+      /// Receives what is queued on the sockets without waiting, for callers with their own poll loop
+      void receive() {
+         for( size_t s = 0; s < sockets.size(); ++s ) {
+            for( size_t n = 0; n < cfg.max_batch; ++n ) {
+               auto f = next_buffer();
+               if( !sockets[s]->recv(f->msg.get(), ZMQ_DONTWAIT) ) {
+                  spare.push_back( std::move(f) );
+                  break;
+               }
+               if( !read(*f) ) {
+                  ++totals.malformed;
+                  spare.push_back( std::move(f) );
+                  continue;
+               }
+               f->shard = s;
+               const uint32_t block_num = f->info.block_num;
+               const bool head_clock = f->info.msg_type != msg_type_irreversible;
+               reassembly.push( s, block_num, std::move(f), head_clock );
+            }
+         }
+      }
+
+      /// Hands what can be released in order to @ref on_batch, in batches of at most config::max_batch
+      template<typename Callback>
+      void deliver( Callback&& on_batch, bool flush ) {
+         auto take = [this]( std::unique_ptr<received>&& f ) { ready.push_back( std::move(f) ); };
+         for( ;; ) {
+            if( flush ) reassembly.flush( take );
+            else reassembly.drain( take, cfg.max_batch - ready.size() );
+            if( ready.empty() ) return;
+            batch.clear();
+            for( auto& r : ready ) {
+               frame f;
+               f.info = r->info;
+               f.shard = r->shard;
+               if( cfg.encoding == frame_encoding::zlib ) {
+                  f.data = r->inflated.data();
+                  f.size = r->inflated.size();
+               } else {
+                  f.data = static_cast<const char*>( r->msg->data() );
+                  f.size = r->msg->size();
+               }
+               batch.push_back( f );
+            }
+            totals.frames += batch.size();
+            ++totals.batches;
+            on_batch( static_cast<const std::vector<frame>&>(batch) );
+            for( auto& r : ready ) spare.push_back( std::move(r) );
+            ready.clear();
+         }
+      }
+
+      const stats& counters()const { return totals; }
+
+   private:
+      /// A received frame; the zmq message owns the bytes the views point into
+      struct received {
+         std::unique_ptr<zmq::message_t> msg{ new zmq::message_t() };
+         std::string                     inflated;
+         frame_info                      info;
+         size_t                          shard = 0;
+      };
+
+      std::unique_ptr<received> next_buffer() {
+         if( spare.empty() ) return std::unique_ptr<received>( new received() );
+         auto f = std::move( spare.back() );
+         spare.pop_back();
+         return f;
+      }
+
+      bool read( received& f ) {
+         const char* data = static_cast<const char*>( f.msg->data() );
+         size_t size = f.msg->size();
+         if( cfg.encoding == frame_encoding::zlib ) {
+            try {
+               zlib_inflate( data, size, f.inflated );
+            } catch( const std::exception& ) {
+               return false;
+            }
+            data = f.inflated.data();
+            size = f.inflated.size();
+         }
+         const auto encoding = cfg.encoding == frame_encoding::binary ? frame_encoding::binary : frame_encoding::json;
+         return read_frame_info( data, size, encoding, f.info );
+      }
+
+      static const uint32_t msg_type_irreversible = 1;
+
+      config                                               cfg;
+      std::vector<std::unique_ptr<zmq::socket_t>>          sockets;
+      std::vector<zmq::pollitem_t>                         items;
+      ordered_reassembly<std::unique_ptr<received>>        reassembly;
+      std::vector<std::unique_ptr<received>>               ready;
+      std::vector<std::unique_ptr<received>>               spare;
+      std::vector<frame>                                   batch;
+      stats                                                totals;
+   };
+
+}
@@ -0,0 +1,120 @@
+/**
+ *  @file
+ *  @copyright eosauthority - free to use and modify - see LICENSE.txt
+ */
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <utility>
+#include <vector>
+
+namespace eosio {
+
+   /**
+    * Checks the seq of consecutive messages of one stream in O(1), so a consumer can ask for just the missing range
+    * (e.g. {"from_seq":...} on a relay's replay socket) instead of resyncing. Only a stream with every message is
+    * contiguous: relay consumers with types or accounts filters see gaps by design, and priority lanes overtake the
+    * messages sent before them. A plugin restart shows up as a gap.
+    */
+   class sequence_tracker {
+   public:
+      enum result { first, next, gap, duplicate };
+
+      result check( uint64_t seq ) {
+         if( !started ) {
+            started = true;
+            last_seq = seq;
+            return first;
+         }
+         if( seq <= last_seq ) return duplicate;
+         const bool contiguous = seq == last_seq + 1;
+         missing_from = last_seq + 1;
+         last_seq = seq;
+         return contiguous ? next : gap;
+      }
+
+      uint64_t last()const { return last_seq; }
+      /// First seq missing before the last gap; the range ends at last() - 1
+      uint64_t gap_start()const { return missing_from; }
+
+   private:
+      bool     started = false;
+      uint64_t last_seq = 0;
+      uint64_t missing_from = 0;
+   };
+
+   /**
+    * Puts frames received on several sockets back into block order, e.g. when a relay splits the stream by msg_type
+    * across consumers. Every socket delivers its own frames in order, so each one's last block_num is a watermark: a
+    * queued frame is released once every other socket has either a frame queued at or above its block, a watermark at
+    * or above it, or has been silent for the stall timeout, which keeps a socket that has nothing to send (no table
+    * deltas, say) from holding the rest back.
+    *
+    * Only frames numbered by the head block set watermarks. Irreversible block messages run on the LIB clock, hundreds
+    * of blocks behind, so a socket carrying them would otherwise hold every head frame back for good; push them with
+    * head_clock false. They are still released in block order against the head watermarks, and a socket with nothing
+    * else counts as silent.
+    *
+    * Frames of one block keep the order of their socket and sockets are taken in index order. A fork switching back to
+    * lower block numbers is released as it arrives, like a single socket would deliver it.
+    */
+   template<typename Frame>
+   class ordered_reassembly {
+   public:
+      typedef std::chrono::steady_clock clock;
+
+      explicit ordered_reassembly( size_t shards, std::chrono::milliseconds stall = std::chrono::milliseconds(1000) )
+      : stall(stall), queues(shards), watermarks(shards, 0), seen(shards, false), last_arrival(shards, clock::now()) {}
+
+      void push( size_t shard, uint32_t block_num, Frame&& frame, bool head_clock = true, clock::time_point now = clock::now() ) {
+         queues[shard].emplace_back( block_num, std::move(frame) );
+         ++queued;
+         if( !head_clock ) return;
+         watermarks[shard] = block_num;
+         seen[shard] = true;
+         last_arrival[shard] = now;
+      }
+
+      /// Calls @ref out with each frame that can be released in order, at most @ref max frames
+      template<typename Out>
+      size_t drain( Out&& out, size_t max = SIZE_MAX, clock::time_point now = clock::now() ) {
+         size_t released = 0;
+         while( queued && released < max ) {
+            size_t next = queues.size();
+            for( size_t s = 0; s < queues.size(); ++s ) {
+               if( !queues[s].empty() && (next == queues.size() || queues[s].front().first < queues[next].front().first) ) next = s;
+            }
+            const uint32_t block_num = queues[next].front().first;
+            bool ready = true;
+            for( size_t s = 0; s < queues.size() && ready; ++s ) {
+               if( s == next || !queues[s].empty() ) continue;
+               ready = (seen[s] && watermarks[s] >= block_num) || now - last_arrival[s] >= stall;
+            }
+            if( !ready ) break;
+            out( std::move(queues[next].front().second) );
+            queues[next].pop_front();
+            --queued;
+            ++released;
+         }
+         return released;
+      }
+
+      /// Releases everything queued, for shutdown
+      template<typename Out>
+      size_t flush( Out&& out ) {
+         return drain( std::forward<Out>(out), SIZE_MAX, clock::time_point::max() );
+      }
+
+      size_t size()const { return queued; }
+
+   private:
+      std::chrono::milliseconds                          stall;
+      std::vector<std::deque<std::pair<uint32_t, Frame>>> queues;
+      std::vector<uint32_t>                              watermarks;   // of head clock frames only, as are the two below
+      std::vector<bool>                                  seen;
+      std::vector<clock::time_point>                     last_arrival;
+      size_t                                             queued = 0;
+   };
+
+}
@@ -0,0 +1,519 @@
+/**
+ *  @file
+ *  @copyright eosauthority - free to use and modify - see LICENSE.txt
+ *
+ *  Decoding of the plugin's binary frames in place: every view points into the received buffer and nothing is copied
+ *  or allocated until a caller asks for a std::string. Views are valid as long as the buffer is.
+ *
+ *  A binary frame is msg_type as a little endian uint32, then the fc::raw packed message. The layouts below follow the
+ *  FC_REFLECT order of the plugin's messages; every message starts with block_num, block_id, previous, timestamp,
+ *  msg_type and seq.
+ */
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+namespace eosio {
+
+   class decode_error : public std::runtime_error {
+   public:
+      explicit decode_error( const char* what ) : std::runtime_error(what) {}
+   };
+
+   /// Bounds checked cursor over a packed buffer
+   class binary_reader {
+   public:
+      binary_reader( const char* p, const char* end ) : p(p), end_(end) {}
+
+      template<typename T>
+      T read() {
+         need( sizeof(T) );
+         T v;
+         memcpy( &v, p, sizeof(T) );
+         p += sizeof(T);
+         return v;
+      }
+
+      /// fc::unsigned_int, a LEB128 varint
+      uint32_t read_varuint() {
+         uint64_t v = 0;
+         for( uint32_t shift = 0; shift < 35; shift += 7 ) {
+            need( 1 );
+            const uint8_t b = uint8_t(*p++);
+            v |= uint64_t(b & 0x7f) << shift;
+            if( !(b & 0x80) ) return uint32_t(v);
+         }
+         throw decode_error( "varint too long" );
+      }
+
+      const char* take( size_t n ) {
+         need( n );
+         const char* r = p;
+         p += n;
+         return r;
+      }
+
+      const char* position()const { return p; }
+      const char* end()const { return end_; }
+
+   private:
+      void need( size_t n )const {
+         if( size_t(end_ - p) < n ) throw decode_error( "truncated frame" );
+      }
+
+      const char* p;
+      const char* end_;
+   };
+
+   /// Names are packed as their uint64 value
+   inline std::string name_to_string( uint64_t value ) {
+      static const char* charmap = ".12345abcdefghijklmnopqrstuvwxyz";
+      std::string str( 13, '.' );
+      uint64_t tmp = value;
+      for( uint32_t i = 0; i <= 12; ++i ) {
+         str[12 - i] = charmap[tmp & (i == 0 ? 0x0f : 0x1f)];
+         tmp >>= (i == 0 ? 4 : 5);
+      }
+      const auto last = str.find_last_not_of( '.' );
+      str.resize( last == std::string::npos ? 0 : last + 1 );
+      return str;
+   }
+
+   /// For comparing decoded names without converting them to strings, e.g. act.account == name_value("eosio.token")
+   inline uint64_t name_value( const char* str ) {
+      uint64_t value = 0;
+      const size_t len = strlen( str );
+      for( size_t i = 0; i <= 12; ++i ) {
+         uint64_t c = 0;
+         if( i < len ) {
+            const char ch = str[i];
+            if( ch >= 'a' && ch <= 'z' ) c = ch - 'a' + 6;
+            else if( ch >= '1' && ch <= '5' ) c = ch - '1' + 1;
+         }
+         if( i < 12 ) value |= (c & 0x1f) << (64 - 5 * (i + 1));
+         else value |= c & 0x0f;
+      }
+      return value;
+   }
+
+   struct bytes_view {
+      const char* data = nullptr;
+      uint32_t    size = 0;
+
+      static const size_t fixed_size = 0;
+
+      static bytes_view parse( binary_reader& r ) {
+         bytes_view b;
+         b.size = r.read_varuint();
+         b.data = r.take( b.size );
+         return b;
+      }
+
+      std::string str()const { return std::string( data, size ); }
+      bool operator==( const char* s )const { return strlen(s) == size && memcmp(data, s, size) == 0; }
+   };
+
+   /// sha256 values: block ids, transaction ids and ABI hashes
+   struct checksum_view {
+      const char* data = nullptr;
+
+      static const size_t fixed_size = 32;
+
+      static checksum_view parse( binary_reader& r ) {
+         checksum_view c;
+         c.data = r.take( fixed_size );
+         return c;
+      }
+
+      std::string hex()const {
+         static const char digits[] = "0123456789abcdef";
+         std::string s( 2 * fixed_size, '0' );
+         for( size_t i = 0; i < fixed_size; ++i ) {
+            s[2 * i] = digits[uint8_t(data[i]) >> 4];
+            s[2 * i + 1] = digits[uint8_t(data[i]) & 15];
+         }
+         return s;
+      }
+
+      bool operator==( const checksum_view& o )const { return memcmp( data, o.data, fixed_size ) == 0; }
+   };
+
+   /**
+    * A packed sequence of T. Walking it is what finds its end, so parse() walks it once; parse_last() does not, for the
+    * last field of a frame, and elements are then checked as they are iterated.
+    */
+   template<typename T>
+   class list_view {
+   public:
+      class iterator {
+      public:
+         iterator( const char* p, const char* end, uint32_t left ) : r(p, end), left(left) { load(); }
+
+         const T& operator*()const { return current; }
+         const T* operator->()const { return &current; }
+         iterator& operator++() { --left; load(); return *this; }
+         bool operator!=( const iterator& o )const { return left != o.left; }
+         bool operator==( const iterator& o )const { return left == o.left; }
+
+      private:
+         void load() { if( left ) current = T::parse( r ); }
+
+         binary_reader r;
+         uint32_t      left;
+         T             current;
+      };
+
+      static list_view parse( binary_reader& r ) {
+         list_view l = parse_last( r );
+         if( T::fixed_size ) {
+            r.take( size_t(l.count) * T::fixed_size );
+         } else {
+            for( uint32_t i = 0; i < l.count; ++i ) T::parse( r );
+         }
+         return l;
+      }
+
+      static list_view parse_last( binary_reader& r ) {
+         list_view l;
+         l.count = r.read_varuint();
+         l.first = r.position();
+         l.end_ = r.end();
+         return l;
+      }
+
+      uint32_t size()const { return count; }
+      bool empty()const { return count == 0; }
+      iterator begin()const { return iterator( first, end_, count ); }
+      iterator end()const { return iterator( end_, end_, 0 ); }
+
+   private:
+      uint32_t    count = 0;
+      const char* first = nullptr;
+      const char* end_ = nullptr;
+   };
+
+   class variant_view;
+
+   struct variant_entry {
+      bytes_view key;
+      const char* value_pos = nullptr;
+      const char* end = nullptr;
+
+      static const size_t fixed_size = 0;
+      static variant_entry parse( binary_reader& r );
+
+      variant_view value()const;
+   };
+
+   /**
+    * An fc::variant packed with fc::raw: a uint8 type, then the value. Decoded action data and table rows are variants;
+    * objects are looked up by key with find().
+    */
+   class variant_view {
+   public:
+      enum type_id { null_type, int64_type, uint64_type, double_type, bool_type, string_type, array_type, object_type, blob_type };
+
+      static const size_t fixed_size = 0;
+
+      static variant_view parse( binary_reader& r ) {
+         variant_view v;
+         v.start = r.position();
+         v.end_ = r.end();
+         skip( r );
+         return v;
+      }
+
+      type_id type()const { return type_id( uint8_t(*start) ); }
+      bool is_null()const { return !valid() || type() == null_type; }
+
+      int64_t as_int64()const { expect( int64_type ); return body().read<int64_t>(); }
+      uint64_t as_uint64()const { expect( uint64_type ); return body().read<uint64_t>(); }
+      double as_double()const { expect( double_type ); return body().read<double>(); }
+      bool as_bool()const { expect( bool_type ); return body().read<uint8_t>() != 0; }
+      bytes_view as_string()const { expect( string_type ); auto r = body(); return bytes_view::parse( r ); }
+      bytes_view as_blob()const { expect( blob_type ); auto r = body(); return bytes_view::parse( r ); }
+
+      list_view<variant_view> as_array()const {
+         expect( array_type );
+         auto r = body();
+         return list_view<variant_view>::parse_last( r );
+      }
+
+      list_view<variant_entry> as_object()const {
+         expect( object_type );
+         auto r = body();
+         return list_view<variant_entry>::parse_last( r );
+      }
+
+      /// Value of @ref key in an object, a default (null) view when it is missing
+      variant_view find( const char* key )const {
+         for( const auto& e : as_object() ) {
+            if( e.key == key ) return e.value();
+         }
+         return variant_view();
+      }
+
+      bool valid()const { return start != nullptr; }
+
+      static variant_view at( const char* p, const char* end ) {
+         variant_view v;
+         v.start = p;
+         v.end_ = end;
+         return v;
+      }
+
+   private:
+      static void skip( binary_reader& r ) {
+         switch( r.read<uint8_t>() ) {
+            case null_type: break;
+            case int64_type: case uint64_type: case double_type: r.take( 8 ); break;
+            case bool_type: r.take( 1 ); break;
+            case string_type: case blob_type: bytes_view::parse( r ); break;
+            case array_type: {
+               const uint32_t n = r.read_varuint();
+               for( uint32_t i = 0; i < n; ++i ) skip( r );
+               break;
+            }
+            case object_type: {
+               const uint32_t n = r.read_varuint();
+               for( uint32_t i = 0; i < n; ++i ) {
+                  bytes_view::parse( r );
+                  skip( r );
+               }
+               break;
+            }
+            default: throw decode_error( "unknown variant type" );
+         }
+      }
+
+      void expect( type_id t )const {
+         if( !valid() || type() != t ) throw decode_error( "unexpected variant type" );
+      }
+
+      binary_reader body()const { return binary_reader( start + 1, end_ ); }
+
+      const char* start = nullptr;
+      const char* end_ = nullptr;
+   };
+
+   inline variant_entry variant_entry::parse( binary_reader& r ) {
+      variant_entry e;
+      e.key = bytes_view::parse( r );
+      e.value_pos = r.position();
+      e.end = r.end();
+      variant_view::parse( r );
+      return e;
+   }
+
+   inline variant_view variant_entry::value()const { return variant_view::at( value_pos, end ); }
+
+   struct permission_view {
+      uint64_t actor = 0;
+      uint64_t permission = 0;
+
+      static const size_t fixed_size = 16;
+
+      static permission_view parse( binary_reader& r ) {
+         permission_view p;
+         p.actor = r.read<uint64_t>();
+         p.permission = r.read<uint64_t>();
+         return p;
+      }
+   };
+
+   struct action_view {
+      uint64_t                   account = 0;
+      uint64_t                   name = 0;
+      uint64_t                   global_sequence = 0;  // unique per action, an idempotency key
+      list_view<permission_view> authorization;
+      variant_view               action_data;        // null when the plugin sent packed data instead
+      bool                       has_data = false;
+      bytes_view                 data;
+      bool                       has_abi_sequence = false;
+      uint64_t                   abi_sequence = 0;
+
+      static const size_t fixed_size = 0;
+
+      static action_view parse( binary_reader& r ) {
+         action_view a;
+         a.account = r.read<uint64_t>();
+         a.name = r.read<uint64_t>();
+         a.global_sequence = r.read<uint64_t>();
+         a.authorization = list_view<permission_view>::parse( r );
+         a.action_data = variant_view::parse( r );
+         if( (a.has_data = r.read<uint8_t>() != 0) ) a.data = bytes_view::parse( r );
+         if( (a.has_abi_sequence = r.read<uint8_t>() != 0) ) a.abi_sequence = r.read<uint64_t>();
+         return a;
+      }
+   };
+
+   struct transaction_view {
+      checksum_view          tx_id;
+      list_view<action_view> actions;
+
+      static const size_t fixed_size = 0;
+
+      static transaction_view parse( binary_reader& r ) {
+         transaction_view t;
+         t.tx_id = checksum_view::parse( r );
+         t.actions = list_view<action_view>::parse( r );
+         return t;
+      }
+   };
+
+   struct message_header_view {
+      uint32_t      msg_type = 0;
+      uint32_t      block_num = 0;
+      checksum_view block_id;
+      checksum_view previous;
+      int64_t       timestamp = 0;   // microseconds since the epoch
+      uint64_t      seq = 0;
+
+      static message_header_view parse( binary_reader& r ) {
+         message_header_view h;
+         r.read<uint32_t>();        // msg_type prefix of the frame
+         h.block_num = r.read<uint32_t>();
+         h.block_id = checksum_view::parse( r );
+         h.previous = checksum_view::parse( r );
+         h.timestamp = r.read<int64_t>();
+         h.msg_type = r.read<uint32_t>();
+         h.seq = r.read<uint64_t>();
+         return h;
+      }
+   };
+
+   /// msg_type 0
+   struct block_message_view {
+      message_header_view         header;
+      uint32_t                    lane = 0;
+      uint32_t                    degraded = 0;
+      list_view<transaction_view> transactions;
+
+      static block_message_view parse( const char* data, size_t len ) {
+         binary_reader r( data, data + len );
+         block_message_view m;
+         m.header = message_header_view::parse( r );
+         m.lane = r.read<uint32_t>();
+         m.degraded = r.read<uint32_t>();
+         m.transactions = list_view<transaction_view>::parse_last( r );
+         return m;
+      }
+   };
+
+   /// msg_type 1
+   struct irreversible_message_view {
+      message_header_view      header;
+      list_view<checksum_view> transactions;
+
+      static irreversible_message_view parse( const char* data, size_t len ) {
+         binary_reader r( data, data + len );
+         irreversible_message_view m;
+         m.header = message_header_view::parse( r );
+         m.transactions = list_view<checksum_view>::parse_last( r );
+         return m;
+      }
+   };
+
+   struct row_delta_view {
+      uint64_t     code = 0;
+      uint64_t     scope = 0;
+      uint64_t     table = 0;
+      uint64_t     primary_key = 0;
+      uint64_t     payer = 0;
+      bytes_view   op;
+      bytes_view   data;
+      variant_view row;
+
+      static const size_t fixed_size = 0;
+
+      static row_delta_view parse( binary_reader& r ) {
+         row_delta_view d;
+         d.code = r.read<uint64_t>();
+         d.scope = r.read<uint64_t>();
+         d.table = r.read<uint64_t>();
+         d.primary_key = r.read<uint64_t>();
+         d.payer = r.read<uint64_t>();
+         d.op = bytes_view::parse( r );
+         d.data = bytes_view::parse( r );
+         d.row = variant_view::parse( r );
+         return d;
+      }
+   };
+
+   /// msg_type 2
+   struct table_delta_message_view {
+      message_header_view       header;
+      list_view<row_delta_view> rows;
+
+      static table_delta_message_view parse( const char* data, size_t len ) {
+         binary_reader r( data, data + len );
+         table_delta_message_view m;
+         m.header = message_header_view::parse( r );
+         m.rows = list_view<row_delta_view>::parse_last( r );
+         return m;
+      }
+   };
+
+   struct candle_view {
+      uint64_t account = 0;
+      uint64_t action = 0;
+      uint32_t window = 0;
+      int64_t  open_time = 0;
+      double   open = 0, high = 0, low = 0, close = 0, volume = 0;
+      uint64_t count = 0;
+
+      static const size_t fixed_size = 8 + 8 + 4 + 8 + 5 * 8 + 8;
+
+      static candle_view parse( binary_reader& r ) {
+         candle_view c;
+         c.account = r.read<uint64_t>();
+         c.action = r.read<uint64_t>();
+         c.window = r.read<uint32_t>();
+         c.open_time = r.read<int64_t>();
+         c.open = r.read<double>();
+         c.high = r.read<double>();
+         c.low = r.read<double>();
+         c.close = r.read<double>();
+         c.volume = r.read<double>();
+         c.count = r.read<uint64_t>();
+         return c;
+      }
+   };
+
+   /// msg_type 3
+   struct aggregate_message_view {
+      message_header_view    header;
+      list_view<candle_view> candles;
+
+      static aggregate_message_view parse( const char* data, size_t len ) {
+         binary_reader r( data, data + len );
+         aggregate_message_view m;
+         m.header = message_header_view::parse( r );
+         m.candles = list_view<candle_view>::parse_last( r );
+         return m;
+      }
+   };
+
+   /// msg_type 4
+   struct abi_message_view {
+      message_header_view header;
+      uint64_t            account = 0;
+      uint64_t            abi_sequence = 0;
+      checksum_view       abi_hash;
+      bytes_view          abi;          // packed abi_def
+
+      static abi_message_view parse( const char* data, size_t len ) {
+         binary_reader r( data, data + len );
+         abi_message_view m;
+         m.header = message_header_view::parse( r );
+         m.account = r.read<uint64_t>();
+         m.abi_sequence = r.read<uint64_t>();
+         m.abi_hash = checksum_view::parse( r );
+         m.abi = bytes_view::parse( r );
+         return m;
+      }
+   };
+
+}
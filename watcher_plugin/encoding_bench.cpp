@@ -0,0 +1,120 @@
+/**
+ *  @file
+ *  @copyright eosauthority - free to use and modify - see LICENSE.txt
+ *
+ *  output_encoding against the fc paths it replaces: every name and buffer is first checked to render exactly like
+ *  name::to_string() and fc::to_hex(), then both are timed on the same inputs. Exits with 1 on any mismatch.
+ */
+#include <eosio/watcher_plugin/output_encoding.hpp>
+#include <eosio/chain/types.hpp>
+
+#include <fc/crypto/hex.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+   struct options {
+      uint32_t names = 1000000;
+      uint32_t ids = 1000000;
+   };
+
+   /// Random names of every length, so trailing dots and the 13th symbol are covered
+   std::vector<uint64_t> make_names( uint32_t count ) {
+      std::mt19937_64 rng( 42 );
+      std::vector<uint64_t> names;
+      names.reserve( count );
+      for( uint32_t i = 0; i < count; ++i ) {
+         const uint32_t len = i % 14;
+         const uint64_t v = rng();
+         names.push_back( len == 0 ? 0 : len == 13 ? v : v & ~(~0ull >> (len * 5)) );
+      }
+      return names;
+   }
+
+   template<typename F>
+   double ns_per_call( uint32_t calls, F&& f ) {
+      const auto start = std::chrono::steady_clock::now();
+      f();
+      return std::chrono::duration<double, std::nano>( std::chrono::steady_clock::now() - start ).count() / calls;
+   }
+}
+
+int main( int argc, char** argv ) {
+   using namespace eosio;
+   options opt;
+   try {
+      for( int i = 1; i + 1 < argc; i += 2 ) {
+         const std::string arg = argv[i];
+         const unsigned long value = std::stoul( argv[i + 1] );
+         if( arg == "--names" ) opt.names = std::max<unsigned long>( 1, value );
+         else if( arg == "--ids" ) opt.ids = std::max<unsigned long>( 1, value );
+         else throw std::invalid_argument( "unknown option " + arg );
+      }
+      if( argc % 2 == 0 ) throw std::invalid_argument( "options take a value" );
+   } catch( const std::exception& e ) {
+      std::cerr << "watcher_encoding_bench: " << e.what() << "\n"
+                << "Usage: watcher_encoding_bench [--names N] [--ids N]\n";
+      return 1;
+   }
+
+   const auto names = make_names( opt.names );
+   std::vector<std::string> buffers;
+   std::mt19937 rng( 7 );
+   for( size_t len = 0; len < 100; ++len ) {
+      std::string b( len, '\0' );
+      for( auto& c : b ) c = char( rng() );
+      buffers.push_back( b );
+   }
+   std::vector<chain::transaction_id_type> ids( 1024 );
+   for( auto& id : ids ) {
+      for( size_t i = 0; i < id.data_size(); ++i ) id.data()[i] = char( rng() );
+   }
+
+   uint64_t mismatches = 0;
+   for( auto n : names ) {
+      if( output_encoding::name_string(n) != chain::name(n).to_string() ) {
+         if( ++mismatches <= 5 ) std::cerr << "name " << n << ": " << output_encoding::name_string(n) << " != " << chain::name(n).to_string() << "\n";
+      }
+   }
+   for( const auto& b : buffers ) {
+      if( output_encoding::hex_string(b.data(), b.size()) != fc::to_hex(b.data(), b.size()) ) {
+         if( ++mismatches <= 5 ) std::cerr << "hex of " << b.size() << " bytes differs\n";
+      }
+   }
+
+   size_t sink = 0;
+   const double fc_name = ns_per_call( opt.names, [&]() {
+      for( auto n : names ) sink += chain::name(n).to_string().size();
+   } );
+   const double our_name = ns_per_call( opt.names, [&]() {
+      char buf[output_encoding::max_name_length];
+      for( auto n : names ) sink += output_encoding::write_name( n, buf ) + buf[0];
+   } );
+   const double fc_hex = ns_per_call( opt.ids, [&]() {
+      for( uint32_t i = 0; i < opt.ids; ++i ) {
+         const auto& id = ids[i & 1023];
+         sink += fc::to_hex( id.data(), id.data_size() ).size();
+      }
+   } );
+   const double our_hex = ns_per_call( opt.ids, [&]() {
+      char buf[64];
+      for( uint32_t i = 0; i < opt.ids; ++i ) {
+         const auto& id = ids[i & 1023];
+         output_encoding::write_hex( id.data(), id.data_size(), buf );
+         sink += buf[i & 63];
+      }
+   } );
+
+   printf( "name to string:    fc %.1f ns, output_encoding %.1f ns (%.1fx)\n", fc_name, our_name, fc_name / our_name );
+   printf( "32-byte id to hex: fc %.1f ns, output_encoding %.1f ns (%.1fx)\n", fc_hex, our_hex, fc_hex / our_hex );
+   if( mismatches ) {
+      printf( "%llu outputs differ from fc\n", (unsigned long long)mismatches );
+      return 1;
+   }
+   return sink == 0;
+}
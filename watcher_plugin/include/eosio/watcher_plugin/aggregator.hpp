@@ -0,0 +1,145 @@
+/**
+ *  @file
+ *  @copyright eosauthority - free to use and modify - see LICENSE.txt
+ */
+#pragma once
+#include <eosio/chain/asset.hpp>
+#include <eosio/chain/types.hpp>
+
+#include <fc/time.hpp>
+#include <fc/variant.hpp>
+#include <fc/variant_object.hpp>
+
+#include <algorithm>
+#include <map>
+#include <vector>
+
+namespace eosio {
+
+   using chain::account_name;
+   using chain::action_name;
+
+   /// Which action fields feed an aggregate, as given by --watch-aggregate account:action:price_field[:volume_field]
+   struct aggregate_spec {
+      account_name account;
+      action_name  action;
+      std::string  price_field;
+      std::string  volume_field;
+   };
+
+   /// OHLC, volume and count of one aggregate over one window, e.g. a 1m candle
+   struct candle {
+      account_name   account;
+      action_name    action;
+      uint32_t       window = 0; // seconds
+      fc::time_point open_time;
+      double         open = 0;
+      double         high = 0;
+      double         low = 0;
+      double         close = 0;
+      double         volume = 0;
+      uint64_t       count = 0;
+   };
+
+   /**
+    * Buckets matched actions into tumbling windows aligned to the epoch, using block time as the clock.
+    * A window is emitted once a block at or past its end has been accepted; windows without samples are skipped.
+    */
+   class window_aggregator {
+   public:
+      bool empty()const { return specs.empty() || windows.empty(); }
+
+      void add_spec( const aggregate_spec& spec ) { specs.push_back(spec); }
+
+      /// True if some aggregate is fed by @ref act of @ref account
+      bool tracks( const account_name& account, const action_name& act )const {
+         for( const auto& spec : specs ) {
+            if( spec.account == account && spec.action == act ) return true;
+         }
+         return false;
+      }
+
+      void set_windows( std::vector<uint32_t> w ) {
+         std::sort( w.begin(), w.end() );
+         w.erase( std::unique( w.begin(), w.end() ), w.end() );
+         windows = std::move(w);
+      }
+
+      void add( const account_name& account, const action_name& act, const fc::variant& data, const fc::time_point& block_time ) {
+         if( !data.is_object() ) return;
+         for( size_t s = 0; s < specs.size(); ++s ) {
+            const auto& spec = specs[s];
+            if( spec.account != account || spec.action != act ) continue;
+
+            double price = 0, volume = 0;
+            if( !field_value( data, spec.price_field, price ) ) continue;
+            if( !spec.volume_field.empty() && !field_value( data, spec.volume_field, volume ) ) continue;
+
+            for( auto w : windows ) {
+               const auto start = window_start( block_time, w );
+               auto& c = open_candles[std::make_pair(s, w)];
+               if( c.count == 0 || c.open_time != start ) {
+                  // A sample past the open window closes it, close_until only runs at block boundaries
+                  if( c.count != 0 ) closed.push_back(c);
+                  c = candle{ spec.account, spec.action, w, start, price, price, price, price, 0, 0 };
+               }
+               c.high = std::max( c.high, price );
+               c.low = std::min( c.low, price );
+               c.close = price;
+               c.volume += volume;
+               ++c.count;
+            }
+         }
+      }
+
+      /// Moves every candle whose window ended at or before @ref block_time into @ref out
+      void close_until( const fc::time_point& block_time, std::vector<candle>& out ) {
+         out.insert( out.end(), closed.begin(), closed.end() );
+         closed.clear();
+         for( auto itr = open_candles.begin(); itr != open_candles.end(); ) {
+            const auto& c = itr->second;
+            if( c.open_time + fc::seconds(c.window) <= block_time ) {
+               out.push_back(c);
+               itr = open_candles.erase(itr);
+            } else {
+               ++itr;
+            }
+         }
+      }
+
+   private:
+      static fc::time_point window_start( const fc::time_point& t, uint32_t window ) {
+         const int64_t us = int64_t(window) * 1000000;
+         return fc::time_point( fc::microseconds( t.time_since_epoch().count() / us * us ) );
+      }
+
+      /// Accepts plain numbers, numeric strings and assets such as "1.0000 EOS"
+      static bool field_value( const fc::variant& data, const std::string& field, double& out ) {
+         const auto& obj = data.get_object();
+         auto itr = obj.find(field);
+         if( itr == obj.end() ) return false;
+         const auto& v = itr->value();
+         try {
+            if( v.is_string() ) {
+               const auto& s = v.get_string();
+               out = s.find(' ') != std::string::npos ? chain::asset::from_string(s).to_real() : std::stod(s);
+            } else if( v.is_numeric() ) {
+               out = v.as_double();
+            } else {
+               return false;
+            }
+         } catch( ... ) {
+            return false;
+         }
+         return true;
+      }
+
+      std::vector<aggregate_spec>                         specs;
+      std::vector<uint32_t>                               windows;
+      std::map<std::pair<size_t, uint32_t>, candle>       open_candles; // keyed by (spec index, window)
+      std::vector<candle>                                 closed;
+   };
+
+}
+
+FC_REFLECT(eosio::candle, (account)(action)(window)(open_time)(open)(high)(low)(close)(volume)(count))
@@ -0,0 +1,250 @@
+/**
+ *  @file
+ *  @copyright eosauthority - free to use and modify - see LICENSE.txt
+ *
+ *  Rotating segment files of outgoing messages, meant to be mmapped by batch jobs and backfills.
+ *
+ *  segment-NNNNNNNN.log holds records of { uint32_t length; payload } back to back. The sidecar segment-NNNNNNNN.idx
+ *  holds fixed size file_sink::index_record entries: one per message plus one per transaction id the message carries,
+ *  each pointing at the record's offset in the .log file.
+ */
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+namespace eosio {
+
+   class file_sink {
+   public:
+      struct frame {
+         std::string                          payload;
+         uint32_t                             block_num = 0;
+         uint32_t                             msg_type = 0;
+         std::vector<std::array<char, 32>>    tx_ids;
+      };
+
+      struct index_record {
+         uint32_t block_num;
+         uint32_t msg_type;
+         uint64_t offset;      // of the record's length prefix in the .log file
+         char     tx_id[32];   // all zero for the message entry itself
+      };
+      static_assert( sizeof(index_record) == 48, "index_record layout is part of the file format" );
+
+      struct config {
+         std::string dir;
+         uint64_t    segment_size = 256 * 1024 * 1024;
+         uint32_t    max_segments = 0;       // oldest segments are deleted beyond this, 0 keeps everything
+         size_t      max_pending = 10000;    // push() blocks while this many frames wait for the writer
+      };
+
+      explicit file_sink( const config& c ) : cfg(c) {
+         mkdir( cfg.dir.c_str(), 0755 );
+         next_segment = scan_segments();
+         open_segment();
+         writer = std::thread( [this]() { run(); } );
+      }
+
+      ~file_sink() {
+         {
+            std::lock_guard<std::mutex> g(mtx);
+            done = true;
+         }
+         not_empty.notify_all();
+         writer.join();
+         close_segment();
+      }
+
+      file_sink( const file_sink& ) = delete;
+      file_sink& operator=( const file_sink& ) = delete;
+
+      size_t capacity()const { return cfg.max_pending; }
+
+      size_t depth()const {
+         std::lock_guard<std::mutex> g(mtx);
+         return pending.size();
+      }
+
+      void push( frame&& f ) {
+         std::unique_lock<std::mutex> g(mtx);
+         not_full.wait( g, [this]() { return pending.size() < cfg.max_pending || failed; } );
+         if( failed ) throw std::runtime_error( "file sink write failed: " + error );
+         pending.emplace_back( std::move(f) );
+         g.unlock();
+         not_empty.notify_one();
+      }
+
+   private:
+      std::string segment_path( uint32_t n, const char* ext )const {
+         char buf[32];
+         snprintf( buf, sizeof(buf), "/segment-%08u.%s", n, ext );
+         return cfg.dir + buf;
+      }
+
+      /// Returns the number after the highest existing segment, so restarts never append to an older file
+      uint32_t scan_segments() {
+         uint32_t lowest = UINT32_MAX, highest = 0;
+         bool any = false;
+         if( DIR* d = opendir(cfg.dir.c_str()) ) {
+            while( dirent* e = readdir(d) ) {
+               uint32_t n;
+               char ext[4];
+               if( sscanf(e->d_name, "segment-%8u.%3s", &n, ext) == 2 && strcmp(ext, "log") == 0 ) {
+                  any = true;
+                  lowest = std::min( lowest, n );
+                  highest = std::max( highest, n );
+               }
+            }
+            closedir(d);
+         }
+         oldest_segment = any ? lowest : 0;
+         return any ? highest + 1 : 0;
+      }
+
+      void open_segment() {
+         log_fd = ::open( segment_path(next_segment, "log").c_str(), O_CREAT | O_WRONLY | O_TRUNC, 0644 );
+         idx_fd = ::open( segment_path(next_segment, "idx").c_str(), O_CREAT | O_WRONLY | O_TRUNC, 0644 );
+         if( log_fd < 0 || idx_fd < 0 ) throw std::runtime_error( "unable to open segment in " + cfg.dir + ": " + strerror(errno) );
+         log_offset = idx_offset = 0;
+         ++next_segment;
+         if( cfg.max_segments ) {
+            while( next_segment - oldest_segment > cfg.max_segments ) {
+               unlink( segment_path(oldest_segment, "log").c_str() );
+               unlink( segment_path(oldest_segment, "idx").c_str() );
+               ++oldest_segment;
+            }
+         }
+      }
+
+      void close_segment() {
+         if( log_fd >= 0 ) ::close( log_fd );
+         if( idx_fd >= 0 ) ::close( idx_fd );
+         log_fd = idx_fd = -1;
+      }
+
+      void write_all( int fd, uint64_t offset, iovec* iov, int cnt ) {
+         while( cnt > 0 ) {
+            ssize_t n = pwritev( fd, iov, cnt, offset );
+            if( n < 0 ) {
+               if( errno == EINTR ) continue;
+               throw std::runtime_error( strerror(errno) );
+            }
+            offset += n;
+            while( cnt > 0 && size_t(n) >= iov->iov_len ) {
+               n -= iov->iov_len;
+               ++iov;
+               --cnt;
+            }
+            if( cnt > 0 ) {
+               iov->iov_base = static_cast<char*>(iov->iov_base) + n;
+               iov->iov_len -= n;
+            }
+         }
+      }
+
+      /// Writes a batch with one pwritev per IOV_MAX/2 frames and one pwrite of the index records
+      void write_batch( std::vector<frame>& batch ) {
+         std::vector<uint32_t> lengths( batch.size() );
+         std::vector<iovec> iov;
+         std::vector<index_record> records;
+         iov.reserve( 2 * batch.size() );
+
+         auto flush = [&]() {
+            if( iov.empty() ) return;
+            write_all( log_fd, log_offset_at_flush, iov.data(), iov.size() );
+            if( !records.empty() ) {
+               iovec rec{ records.data(), records.size() * sizeof(index_record) };
+               write_all( idx_fd, idx_offset, &rec, 1 );
+               idx_offset += rec.iov_len;
+            }
+            iov.clear();
+            records.clear();
+            log_offset_at_flush = log_offset;
+         };
+
+         log_offset_at_flush = log_offset;
+         for( size_t i = 0; i < batch.size(); ++i ) {
+            auto& f = batch[i];
+            if( log_offset > 0 && log_offset + 4 + f.payload.size() > cfg.segment_size ) {
+               flush();
+               close_segment();
+               open_segment();
+               log_offset_at_flush = log_offset;
+            }
+            index_record rec{ f.block_num, f.msg_type, log_offset, {} };
+            records.push_back( rec );
+            for( const auto& id : f.tx_ids ) {
+               memcpy( rec.tx_id, id.data(), sizeof(rec.tx_id) );
+               records.push_back( rec );
+            }
+            lengths[i] = f.payload.size();
+            iov.push_back( iovec{ &lengths[i], sizeof(uint32_t) } );
+            iov.push_back( iovec{ &f.payload[0], f.payload.size() } );
+            log_offset += sizeof(uint32_t) + f.payload.size();
+            if( iov.size() + 2 > IOV_MAX ) flush();
+         }
+         flush();
+      }
+
+      void run() {
+         std::vector<frame> batch;
+         while( true ) {
+            {
+               std::unique_lock<std::mutex> g(mtx);
+               not_empty.wait( g, [this]() { return !pending.empty() || done; } );
+               if( pending.empty() && done ) return;
+               batch.assign( std::make_move_iterator(pending.begin()), std::make_move_iterator(pending.end()) );
+               pending.clear();
+            }
+            not_full.notify_all();
+            try {
+               write_batch( batch );
+            } catch( const std::exception& e ) {
+               std::lock_guard<std::mutex> g(mtx);
+               failed = true;
+               error = e.what();
+               not_full.notify_all();
+               return;
+            }
+            batch.clear();
+         }
+      }
+
+      config                    cfg;
+      int                       log_fd = -1;
+      int                       idx_fd = -1;
+      uint64_t                  log_offset = 0;
+      uint64_t                  log_offset_at_flush = 0;
+      uint64_t                  idx_offset = 0;
+      uint32_t                  next_segment = 0;
+      uint32_t                  oldest_segment = 0;
+
+      mutable std::mutex        mtx;
+      std::condition_variable   not_empty;
+      std::condition_variable   not_full;
+      std::deque<frame>         pending;
+      bool                      done = false;
+      bool                      failed = false;
+      std::string               error;
+      std::thread               writer;
+   };
+
+}
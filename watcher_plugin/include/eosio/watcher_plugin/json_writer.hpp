@@ -0,0 +1,351 @@
+/**
+ *  @file
+ *  @copyright eosauthority - free to use and modify - see LICENSE.txt
+ */
+#pragma once
+#include <eosio/watcher_plugin/output_encoding.hpp>
+#include <eosio/chain/name.hpp>
+
+#include <fc/crypto/sha256.hpp>
+#include <fc/optional.hpp>
+#include <fc/reflect/reflect.hpp>
+#include <fc/time.hpp>
+#include <fc/variant.hpp>
+#include <fc/variant_object.hpp>
+
+#include <algorithm>
+#include <cstdio>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace eosio {
+
+   /**
+    * Appends JSON for FC_REFLECTed messages to a string, without building an fc::variant first.
+    *
+    * The output reads back to the same values as fc::json::to_string(): fields in FC_REFLECT order, unset optionals
+    * left out, integers above 0xffffffff and doubles quoted, names and time_points as strings, bytes and checksums as
+    * hex and variant blobs as base64. Like fc::escape_string, bytes that don't start a valid UTF-8 sequence are dropped.
+    * Strings are scanned 16 bytes at a time for characters that need escaping and non-ASCII bytes, so long ASCII memos
+    * are mostly copied in bulk; bytes are hex encoded 16 at a time.
+    */
+   class json_writer {
+   public:
+      explicit json_writer( std::string& out ) : out(out) {}
+
+      void write( bool b ) { out += b ? "true" : "false"; }
+
+      template<typename T>
+      typename std::enable_if<std::is_integral<T>::value && std::is_signed<T>::value>::type write( T v ) {
+         write_int( int64_t(v) );
+      }
+
+      template<typename T>
+      typename std::enable_if<std::is_integral<T>::value && std::is_unsigned<T>::value>::type write( T v ) {
+         write_uint( uint64_t(v) );
+      }
+
+      void write( double d ) {
+         char buf[400];
+         // fc::to_string(double): fixed notation with digits10 + 2 decimals
+         const int len = snprintf( buf, sizeof(buf), "%.17f", d );
+         out += '"';
+         out.append( buf, std::min<size_t>(len, sizeof(buf) - 1) );
+         out += '"';
+      }
+
+      void write( const std::string& s ) { write_string( s.data(), s.size() ); }
+      void write( const char* s ) { write_string( s, strlen(s) ); }
+
+      void write( const chain::name& n ) {
+         out += '"';
+         output_encoding::append_name( out, n.value );
+         out += '"';
+      }
+
+      void write( const fc::sha256& h ) {
+         out += '"';
+         output_encoding::append_hex( out, h.data(), h.data_size() );
+         out += '"';
+      }
+
+      void write( const std::vector<char>& bytes ) {
+         out += '"';
+         output_encoding::append_hex( out, bytes.data(), bytes.size() );
+         out += '"';
+      }
+
+      void write( const fc::time_point& t ) {
+         out += '"';
+         append_iso_time( t.time_since_epoch().count() );
+         out += '"';
+      }
+
+      template<typename T>
+      void write( const fc::optional<T>& v ) {
+         if( v.valid() ) write( *v );
+         else out += "null";
+      }
+
+      template<typename T>
+      void write( const std::vector<T>& v ) {
+         out += '[';
+         for( size_t i = 0; i < v.size(); ++i ) {
+            if( i ) out += ',';
+            write( v[i] );
+         }
+         out += ']';
+      }
+
+      void write( const fc::variant& v ) {
+         switch( v.get_type() ) {
+            case fc::variant::null_type:   out += "null"; break;
+            case fc::variant::int64_type:  write_int( v.as_int64() ); break;
+            case fc::variant::uint64_type: write_uint( v.as_uint64() ); break;
+            case fc::variant::double_type: write( v.as_double() ); break;
+            case fc::variant::bool_type:   write( v.as_bool() ); break;
+            case fc::variant::string_type: write( v.get_string() ); break;
+            case fc::variant::array_type:  write( v.get_array() ); break;
+            case fc::variant::object_type: write( v.get_object() ); break;
+            case fc::variant::blob_type:   write_base64( v.get_blob().data ); break;
+         }
+      }
+
+      void write( const fc::variant_object& o ) {
+         out += '{';
+         bool first = true;
+         for( const auto& e : o ) {
+            if( !first ) out += ',';
+            first = false;
+            write( e.key() );
+            out += ':';
+            write( e.value() );
+         }
+         out += '}';
+      }
+
+      template<typename T>
+      typename std::enable_if<fc::reflector<T>::is_defined::value>::type write( const T& v ) {
+         out += '{';
+         bool first = true;
+         fc::reflector<T>::visit( member_writer<T>( *this, v, first ) );
+         out += '}';
+      }
+
+      void write_string( const char* s, size_t len ) {
+         out += '"';
+         size_t run = 0; // start of the bytes not yet copied
+         size_t i = 0;
+#if defined(__SSE2__)
+         const __m128i control_max = _mm_set1_epi8( 0x1f );
+         const __m128i quote = _mm_set1_epi8( '"' );
+         const __m128i backslash = _mm_set1_epi8( '\\' );
+         const __m128i del = _mm_set1_epi8( 0x7f );
+         while( i + 16 <= len ) {
+            const __m128i chunk = _mm_loadu_si128( reinterpret_cast<const __m128i*>(s + i) );
+            const __m128i control = _mm_cmpeq_epi8( _mm_max_epu8(chunk, control_max), control_max );
+            const __m128i special = _mm_or_si128( _mm_or_si128(control, _mm_cmpeq_epi8(chunk, quote)),
+                                                  _mm_or_si128(_mm_cmpeq_epi8(chunk, backslash), _mm_cmpeq_epi8(chunk, del)) );
+            // The sign bits are the bytes of multibyte sequences, which have to be validated
+            const int mask = _mm_movemask_epi8( special ) | _mm_movemask_epi8( chunk );
+            if( mask == 0 ) {
+               i += 16;
+               continue;
+            }
+            i = write_special( s, len, i + __builtin_ctz( mask ), run );
+         }
+#endif
+         while( i < len ) {
+            const uint8_t c = s[i];
+            if( c < 0x20 || c == '"' || c == '\\' || c >= 0x7f ) {
+               i = write_special( s, len, i, run );
+            } else {
+               ++i;
+            }
+         }
+         out.append( s + run, len - run );
+         out += '"';
+      }
+
+      void write_base64( const std::vector<char>& data ) {
+         static const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+         const auto* in = reinterpret_cast<const uint8_t*>( data.data() );
+         const size_t len = data.size();
+         const size_t pos = out.size();
+         out.resize( pos + 2 + (len + 2) / 3 * 4 );
+         char* o = &out[pos];
+         *o++ = '"';
+         size_t i = 0;
+         for( ; i + 3 <= len; i += 3 ) {
+            const uint32_t v = uint32_t(in[i]) << 16 | uint32_t(in[i + 1]) << 8 | in[i + 2];
+            o[0] = alphabet[v >> 18];
+            o[1] = alphabet[(v >> 12) & 0x3f];
+            o[2] = alphabet[(v >> 6) & 0x3f];
+            o[3] = alphabet[v & 0x3f];
+            o += 4;
+         }
+         if( i < len ) {
+            const uint32_t v = uint32_t(in[i]) << 16 | (i + 1 < len ? uint32_t(in[i + 1]) << 8 : 0);
+            o[0] = alphabet[v >> 18];
+            o[1] = alphabet[(v >> 12) & 0x3f];
+            o[2] = i + 1 < len ? alphabet[(v >> 6) & 0x3f] : '=';
+            o[3] = '=';
+            o += 4;
+         }
+         *o = '"';
+      }
+
+   private:
+      template<typename T>
+      struct member_writer {
+         member_writer( json_writer& w, const T& v, bool& first ) : w(w), v(v), first(first) {}
+
+         template<typename Member, class Class, Member (Class::*member)>
+         void operator()( const char* name )const {
+            add( name, v.*member );
+         }
+
+         template<typename M>
+         void add( const char* name, const fc::optional<M>& m )const {
+            if( m.valid() ) add( name, *m );
+         }
+
+         template<typename M>
+         void add( const char* name, const M& m )const {
+            if( !first ) w.out += ',';
+            first = false;
+            w.out += '"';
+            w.out += name;
+            w.out += "\":";
+            w.write( m );
+         }
+
+         json_writer& w;
+         const T&     v;
+         bool&        first;
+      };
+
+      void write_int( int64_t v ) {
+         char buf[24];
+         const int len = snprintf( buf, sizeof(buf), "%lld", static_cast<long long>(v) );
+         // Like fc::json, which only quotes large positive values
+         const bool quote = v > 0xffffffffll;
+         if( quote ) out += '"';
+         out.append( buf, len );
+         if( quote ) out += '"';
+      }
+
+      void write_uint( uint64_t v ) {
+         const bool quote = v > 0xffffffffull;
+         char buf[24];
+         char* p = buf + sizeof(buf);
+         do {
+            *--p = '0' + v % 10;
+            v /= 10;
+         } while( v );
+         if( quote ) out += '"';
+         out.append( p, buf + sizeof(buf) - p );
+         if( quote ) out += '"';
+      }
+
+      /// Escapes s[i], keeps the UTF-8 sequence starting there or drops its first byte; returns where scanning resumes
+      size_t write_special( const char* s, size_t len, size_t i, size_t& run ) {
+         const uint8_t c = s[i];
+         if( c >= 0x80 ) {
+            const size_t n = utf8_length( reinterpret_cast<const uint8_t*>(s + i), len - i );
+            if( n ) return i + n;
+            // fc's prune_invalid_utf8 skips one byte and validates again from the next
+            out.append( s + run, i - run );
+            return run = i + 1;
+         }
+         out.append( s + run, i - run );
+         escape( c );
+         return run = i + 1;
+      }
+
+      /// Length of the valid UTF-8 sequence at @ref s, 0 if there is none: the rules of the utf8-cpp validator fc uses,
+      /// which rejects overlong forms, surrogates and code points past 0x10ffff
+      static size_t utf8_length( const uint8_t* s, size_t len ) {
+         size_t n;
+         uint32_t cp;
+         if( (s[0] >> 5) == 0x6 )       { n = 2; cp = s[0] & 0x1f; }
+         else if( (s[0] >> 4) == 0xe )  { n = 3; cp = s[0] & 0x0f; }
+         else if( (s[0] >> 3) == 0x1e ) { n = 4; cp = s[0] & 0x07; }
+         else return 0;
+         if( len < n ) return 0;
+         for( size_t k = 1; k < n; ++k ) {
+            if( (s[k] & 0xc0) != 0x80 ) return 0;
+            cp = cp << 6 | (s[k] & 0x3f);
+         }
+         if( cp < 0x80 || (n > 2 && cp < 0x800) || (n > 3 && cp < 0x10000) ) return 0;
+         if( cp > 0x10ffff || (cp >= 0xd800 && cp <= 0xdfff) ) return 0;
+         return n;
+      }
+
+      void escape( uint8_t c ) {
+         switch( c ) {
+            case '"':  out += "\\\""; break;
+            case '\\': out += "\\\\"; break;
+            case '\b': out += "\\b"; break;
+            case '\f': out += "\\f"; break;
+            case '\n': out += "\\n"; break;
+            case '\r': out += "\\r"; break;
+            case '\t': out += "\\t"; break;
+            default: {
+               static const char digits[] = "0123456789abcdef";
+               const char u[6] = { '\\', 'u', '0', '0', digits[c >> 4], digits[c & 0x0f] };
+               out.append( u, sizeof(u) );
+            }
+         }
+      }
+
+      /// fc's time_point string form: YYYY-MM-DDTHH:MM:SS.mmm in UTC
+      void append_iso_time( int64_t us ) {
+         int64_t secs = us / 1000000;
+         int64_t ms = (us % 1000000) / 1000;
+         if( us < 0 && us % 1000000 ) {
+            --secs;
+            ms = (us % 1000000 + 1000000) / 1000;
+         }
+         int64_t days = secs / 86400;
+         int64_t rem = secs % 86400;
+         if( rem < 0 ) {
+            rem += 86400;
+            --days;
+         }
+         // civil_from_days, http://howardhinnant.github.io/date_algorithms.html
+         days += 719468;
+         const int64_t era = (days >= 0 ? days : days - 146096) / 146097;
+         const int64_t doe = days - era * 146097;
+         const int64_t yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+         const int64_t doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+         const int64_t mp = (5 * doy + 2) / 153;
+         const int64_t d = doy - (153 * mp + 2) / 5 + 1;
+         const int64_t m = mp < 10 ? mp + 3 : mp - 9;
+         const int64_t y = yoe + era * 400 + (m <= 2);
+         char buf[40];
+         const int len = snprintf( buf, sizeof(buf), "%04lld-%02lld-%02lldT%02lld:%02lld:%02lld.%03lld",
+                                   static_cast<long long>(y), static_cast<long long>(m), static_cast<long long>(d),
+                                   static_cast<long long>(rem / 3600), static_cast<long long>(rem % 3600 / 60),
+                                   static_cast<long long>(rem % 60), static_cast<long long>(ms) );
+         out.append( buf, len );
+      }
+
+      std::string& out;
+   };
+
+   /// JSON of a reflected message, read the same way as fc::json::to_string()
+   template<typename T>
+   std::string to_json( const T& v ) {
+      std::string out;
+      out.reserve( 512 );
+      json_writer( out ).write( v );
+      return out;
+   }
+
+}
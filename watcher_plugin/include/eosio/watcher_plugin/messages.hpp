@@ -0,0 +1,128 @@
+/**
+ *  @file
+ *  @copyright eosauthority - free to use and modify - see LICENSE.txt
+ */
+#pragma once
+#include <eosio/watcher_plugin/aggregator.hpp>
+#include <eosio/chain/action.hpp>
+#include <eosio/chain/types.hpp>
+
+#include <fc/crypto/sha256.hpp>
+#include <fc/optional.hpp>
+#include <fc/reflect/reflect.hpp>
+#include <fc/time.hpp>
+#include <fc/variant.hpp>
+
+#include <vector>
+
+namespace eosio { namespace watcher {
+
+   using chain::account_name;
+   using chain::action_name;
+   using chain::block_id_type;
+   using chain::bytes;
+   using chain::permission_level;
+   using chain::scope_name;
+   using chain::table_name;
+   using chain::transaction_id_type;
+
+   /// The messages the plugin sends, encoded as json, fc::raw (binary) or zlib compressed json
+   struct action_notif {
+      action_notif( const chain::action& act, const fc::variant& action_data )
+      : account(act.account), name(act.name), authorization(act.authorization), action_data(action_data) {}
+
+      account_name                  account;
+      action_name                   name;
+      uint64_t                      global_sequence = 0; // unique per action on the chain, an idempotency key for consumers
+      std::vector<permission_level> authorization;
+      fc::variant                   action_data;
+      fc::optional<bytes>           data;                // set instead of action_data when degraded
+      fc::optional<uint64_t>        abi_sequence;
+   };
+
+   struct transaction {
+      transaction_id_type       tx_id;
+      std::vector<action_notif> actions;
+   };
+
+   // Every message starts with the same header: block_num, block_id, previous, timestamp, msg_type, seq. Relays and
+   // mergers read it at fixed positions of the frame without decoding the rest. seq numbers the messages of the
+   // stream, so consumers find gaps and duplicates by comparing it with the last one
+   struct irreversible_block_message {
+      uint32_t                         block_num;
+      block_id_type                    block_id;
+      block_id_type                    previous;
+      fc::time_point                   timestamp;
+      uint32_t                         msg_type;
+      uint64_t                         seq = 0;
+      std::vector<transaction_id_type> transactions;
+   };
+
+   struct message {
+      uint32_t                 block_num;
+      block_id_type            block_id;
+      block_id_type            previous;
+      fc::time_point           timestamp;
+      uint32_t                 msg_type;
+      uint64_t                 seq = 0;
+      uint32_t                 lane = 0;
+      uint32_t                 degraded = 0;   // degradation tier, 0 for complete messages
+      std::vector<transaction> transactions;
+   };
+
+   struct row_delta {
+      account_name code;
+      scope_name   scope;
+      table_name   table;
+      uint64_t     primary_key = 0;
+      account_name payer;
+      // insert, modify or remove; modify carries the row at the end of the block, remove the row as it was at the start of
+      // the block (chainbase's undo session keeps that), without changes made earlier in the same block
+      fc::string   op;
+      bytes        data;
+      fc::variant  row;
+   };
+
+   struct table_delta_message {
+      uint32_t               block_num;
+      block_id_type          block_id;
+      block_id_type          previous;
+      fc::time_point         timestamp;
+      uint32_t               msg_type;
+      uint64_t               seq = 0;
+      std::vector<row_delta> rows;
+   };
+
+   struct abi_message {
+      uint32_t       block_num;
+      block_id_type  block_id;
+      block_id_type  previous;
+      fc::time_point timestamp;
+      uint32_t       msg_type;
+      uint64_t       seq = 0;
+      account_name   account;
+      uint64_t       abi_sequence = 0;
+      fc::sha256     abi_hash;
+      bytes          abi;       // packed abi_def, as stored by setabi
+   };
+
+   struct aggregate_message {
+      uint32_t            block_num;
+      block_id_type       block_id;
+      block_id_type       previous;
+      fc::time_point      timestamp;
+      uint32_t            msg_type;
+      uint64_t            seq = 0;
+      std::vector<candle> candles;
+   };
+
+} }
+
+FC_REFLECT(eosio::watcher::action_notif, (account)(name)(global_sequence)(authorization)(action_data)(data)(abi_sequence))
+FC_REFLECT(eosio::watcher::message, (block_num)(block_id)(previous)(timestamp)(msg_type)(seq)(lane)(degraded)(transactions))
+FC_REFLECT(eosio::watcher::irreversible_block_message, (block_num)(block_id)(previous)(timestamp)(msg_type)(seq)(transactions))
+FC_REFLECT(eosio::watcher::transaction, (tx_id)(actions))
+FC_REFLECT(eosio::watcher::row_delta, (code)(scope)(table)(primary_key)(payer)(op)(data)(row))
+FC_REFLECT(eosio::watcher::table_delta_message, (block_num)(block_id)(previous)(timestamp)(msg_type)(seq)(rows))
+FC_REFLECT(eosio::watcher::abi_message, (block_num)(block_id)(previous)(timestamp)(msg_type)(seq)(account)(abi_sequence)(abi_hash)(abi))
+FC_REFLECT(eosio::watcher::aggregate_message, (block_num)(block_id)(previous)(timestamp)(msg_type)(seq)(candles))
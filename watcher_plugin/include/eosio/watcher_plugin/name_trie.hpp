@@ -0,0 +1,125 @@
+/**
+ *  @file
+ *  @copyright eosauthority - free to use and modify - see LICENSE.txt
+ */
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace eosio {
+
+   /**
+    * Trie over the 5-bit symbol encoding of eosio names.
+    *
+    * A name packs up to 13 symbols into a uint64_t, the first 12 as 5-bit groups from the most significant
+    * bit down and the 13th in the low 4 bits. Fragments are stored as symbol paths so matching a name walks at
+    * most 13 nodes, with one array lookup per symbol, no matter how many names a fragment covers.
+    */
+   class name_trie {
+   public:
+      static constexpr uint32_t max_symbols = 13;
+
+      static uint8_t char_to_symbol( char c ) {
+         if( c >= 'a' && c <= 'z' ) return (c - 'a') + 6;
+         if( c >= '1' && c <= '5' ) return (c - '1') + 1;
+         if( c == '.' ) return 0;
+         throw std::invalid_argument( std::string("invalid name character '") + c + "'" );
+      }
+
+      static uint8_t symbol_at( uint64_t value, uint32_t i ) {
+         return i < 12 ? (value >> (64 - 5 * (i + 1))) & 0x1f : value & 0x0f;
+      }
+
+      /// Number of symbols in the string form of a name, i.e. without trailing dots
+      static uint32_t length_of( uint64_t value ) {
+         uint32_t len = max_symbols;
+         while( len > 0 && symbol_at(value, len - 1) == 0 ) --len;
+         return len;
+      }
+
+      name_trie() : nodes(1) {}
+
+      bool empty()const { return nodes.size() == 1 && !nodes[0].terminal; }
+
+      void insert( const std::vector<uint8_t>& symbols ) {
+         uint32_t cur = 0;
+         for( auto s : symbols ) {
+            uint32_t next = nodes[cur].next[s];
+            if( next == 0 ) {
+               next = nodes.size();
+               nodes.emplace_back();
+               nodes[cur].next[s] = next;
+            }
+            cur = next;
+         }
+         nodes[cur].terminal = true;
+      }
+
+      /// Walks symbols [0, len) of @ref value forward, or backward from len-1 when @ref reverse is set
+      bool match( uint64_t value, bool reverse )const {
+         const uint32_t len = length_of(value);
+         uint32_t cur = 0;
+         for( uint32_t n = 0; n < len; ++n ) {
+            if( nodes[cur].terminal ) return true;
+            cur = nodes[cur].next[symbol_at(value, reverse ? len - 1 - n : n)];
+            if( cur == 0 ) return false;
+         }
+         return nodes[cur].terminal;
+      }
+
+   private:
+      struct node {
+         node() { next.fill(0); }
+         std::array<uint32_t, 32> next;  // 0 means no child; the root is never a child
+         bool                     terminal = false;
+      };
+
+      std::vector<node> nodes;
+   };
+
+   /**
+    * Account patterns accepted by --watch: `prefix*` or `*suffix`, e.g. `chin*` or `*.chintai`.
+    */
+   class name_pattern_set {
+   public:
+      bool empty()const { return prefixes.empty() && suffixes.empty(); }
+
+      static bool is_pattern( const std::string& s ) { return s.find('*') != std::string::npos; }
+
+      /// Throws std::invalid_argument if @ref pattern is not a single leading or trailing wildcard around a name fragment
+      void add( const std::string& pattern ) {
+         const auto star = pattern.find('*');
+         if( pattern.size() < 2 || pattern.find('*', star + 1) != std::string::npos ||
+             (star != 0 && star != pattern.size() - 1) )
+            throw std::invalid_argument( "pattern must be prefix* or *suffix" );
+
+         const bool suffix = star == 0;
+         const std::string fragment = suffix ? pattern.substr(1) : pattern.substr(0, pattern.size() - 1);
+         if( fragment.size() > 12 )
+            throw std::invalid_argument( "pattern fragment longer than 12 characters" );
+
+         std::vector<uint8_t> symbols;
+         symbols.reserve(fragment.size());
+         for( char c : fragment ) symbols.push_back( name_trie::char_to_symbol(c) );
+         if( suffix ) {
+            std::reverse( symbols.begin(), symbols.end() );
+            suffixes.insert( symbols );
+         } else {
+            prefixes.insert( symbols );
+         }
+      }
+
+      bool match( uint64_t value )const {
+         return prefixes.match(value, false) || suffixes.match(value, true);
+      }
+
+   private:
+      name_trie prefixes;
+      name_trie suffixes;
+   };
+
+}
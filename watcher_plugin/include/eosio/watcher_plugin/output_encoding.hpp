@@ -0,0 +1,137 @@
+/**
+ *  @file
+ *  @copyright eosauthority - free to use and modify - see LICENSE.txt
+ *
+ *  Allocation free rendering of eosio names and checksums, writing straight into the caller's buffer. Output is
+ *  identical to name::to_string() and fc::to_hex().
+ */
+#pragma once
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <unordered_map>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace eosio {
+
+   namespace output_encoding {
+
+      constexpr size_t max_name_length = 13;
+
+      /// Two characters per pair of 5-bit name symbols, so a name renders in 6 lookups plus one for the 13th symbol
+      struct name_pair_table {
+         std::array<char, 2048> pairs;
+
+         name_pair_table() {
+            static const char charmap[] = ".12345abcdefghijklmnopqrstuvwxyz";
+            for( uint32_t i = 0; i < 1024; ++i ) {
+               pairs[2 * i] = charmap[i >> 5];
+               pairs[2 * i + 1] = charmap[i & 0x1f];
+            }
+         }
+
+         static const name_pair_table& get() {
+            static const name_pair_table table;
+            return table;
+         }
+      };
+
+      /// Number of characters in the string form of a name, i.e. without trailing dots
+      inline size_t name_length( uint64_t value ) {
+         if( value & 0x0f ) return 13;
+         value >>= 4;
+         if( value == 0 ) return 0;
+         return 12 - __builtin_ctzll(value) / 5;
+      }
+
+      /**
+       * Writes the name to @ref out and returns its length. Always stores max_name_length bytes, only the returned
+       * length of them is the name.
+       */
+      inline size_t write_name( uint64_t value, char* out ) {
+         const auto& pairs = name_pair_table::get().pairs;
+         for( int i = 0; i < 6; ++i ) {
+            memcpy( out + 2 * i, &pairs[2 * ((value >> (54 - 10 * i)) & 0x3ff)], 2 );
+         }
+         out[12] = ".12345abcdefghij"[value & 0x0f];
+         return name_length( value );
+      }
+
+      inline void append_name( std::string& out, uint64_t value ) {
+         const size_t pos = out.size();
+         out.resize( pos + max_name_length );
+         out.resize( pos + write_name(value, &out[pos]) );
+      }
+
+      inline std::string name_string( uint64_t value ) {
+         char buf[max_name_length];
+         return std::string( buf, write_name(value, buf) );
+      }
+
+      /// Writes 2 * @ref len lowercase hex digits of @ref in to @ref out
+      inline void write_hex( const char* in, size_t len, char* out ) {
+         size_t i = 0;
+#if defined(__SSE2__)
+         const __m128i low_nibble = _mm_set1_epi8( 0x0f );
+         const __m128i nine = _mm_set1_epi8( 9 );
+         const __m128i zero = _mm_set1_epi8( '0' );
+         const __m128i letter_gap = _mm_set1_epi8( 'a' - '0' - 10 );
+         auto digits = [&]( __m128i nibbles ) {
+            const __m128i letters = _mm_and_si128( _mm_cmpgt_epi8(nibbles, nine), letter_gap );
+            return _mm_add_epi8( _mm_add_epi8(nibbles, zero), letters );
+         };
+         for( ; i + 16 <= len; i += 16 ) {
+            const __m128i bytes = _mm_loadu_si128( reinterpret_cast<const __m128i*>(in + i) );
+            const __m128i hi = digits( _mm_and_si128(_mm_srli_epi16(bytes, 4), low_nibble) );
+            const __m128i lo = digits( _mm_and_si128(bytes, low_nibble) );
+            _mm_storeu_si128( reinterpret_cast<__m128i*>(out + 2 * i), _mm_unpacklo_epi8(hi, lo) );
+            _mm_storeu_si128( reinterpret_cast<__m128i*>(out + 2 * i + 16), _mm_unpackhi_epi8(hi, lo) );
+         }
+#endif
+         static const char digits_table[] = "0123456789abcdef";
+         for( ; i < len; ++i ) {
+            const uint8_t b = in[i];
+            out[2 * i] = digits_table[b >> 4];
+            out[2 * i + 1] = digits_table[b & 0x0f];
+         }
+      }
+
+      inline void append_hex( std::string& out, const char* in, size_t len ) {
+         const size_t pos = out.size();
+         out.resize( pos + 2 * len );
+         write_hex( in, len, &out[pos] );
+      }
+
+      inline std::string hex_string( const char* in, size_t len ) {
+         std::string out;
+         append_hex( out, in, len );
+         return out;
+      }
+
+      /**
+       * Interned string forms of names. Meant for the small set of watched accounts and actions that show up in every
+       * log line; when more than @ref capacity distinct names were seen it simply starts over.
+       */
+      class name_cache {
+      public:
+         explicit name_cache( size_t capacity = 4096 ) : capacity(capacity) {}
+
+         const std::string& operator()( uint64_t value ) {
+            auto itr = names.find( value );
+            if( itr != names.end() ) return itr->second;
+            if( names.size() >= capacity ) names.clear();
+            return names.emplace( value, name_string(value) ).first->second;
+         }
+
+      private:
+         size_t                                 capacity;
+         std::unordered_map<uint64_t, std::string> names;
+      };
+
+   }
+
+}
@@ -0,0 +1,108 @@
+/**
+ *  @file
+ *  @copyright eosauthority - free to use and modify - see LICENSE.txt
+ */
+#pragma once
+#include <eosio/chain/abi_serializer.hpp>
+
+#include <fc/io/datastream.hpp>
+#include <fc/io/raw.hpp>
+#include <fc/io/varint.hpp>
+#include <fc/variant_object.hpp>
+
+#include <set>
+#include <string>
+#include <vector>
+
+namespace eosio {
+
+   using chain::abi_serializer;
+   using chain::type_name;
+
+   /**
+    * Decode plan for the fields of one action that --watch-project asks for.
+    *
+    * Compiled once per ABI: the action struct (bases first) is flattened into steps up to the last projected field.
+    * Projected fields are decoded with the ABI, other fields are skipped by their wire size where the type allows it,
+    * and nothing after the last projected field is read at all.
+    */
+   class projection_plan {
+   public:
+      projection_plan() = default;
+
+      projection_plan( const abi_serializer& abi, const type_name& action_type, const std::set<std::string>& fields ) {
+         std::vector<chain::field_def> flat;
+         flatten( abi, action_type, flat );
+         size_t last = 0;
+         std::set<std::string> found;
+         for( size_t i = 0; i < flat.size(); ++i ) {
+            if( fields.count(flat[i].name) ) {
+               last = i + 1;
+               found.insert( flat[i].name );
+            }
+         }
+         for( const auto& f : fields ) {
+            if( !found.count(f) ) missing.push_back( f );
+         }
+         for( size_t i = 0; i < last; ++i ) {
+            const auto resolved = abi.resolve_type( flat[i].type );
+            steps.push_back( step{ flat[i].name, resolved, fields.count(flat[i].name) != 0, fixed_size(resolved) } );
+         }
+      }
+
+      /// Projected fields the action type doesn't have, they never show up in the decoded data
+      const std::vector<std::string>& missing_fields()const { return missing; }
+
+      fc::variant decode( const abi_serializer& abi, const chain::bytes& data, const fc::microseconds& max_time )const {
+         fc::datastream<const char*> ds( data.data(), data.size() );
+         fc::mutable_variant_object result;
+         for( const auto& s : steps ) {
+            if( s.project ) {
+               result( s.name, abi.binary_to_variant( s.type, ds, max_time ) );
+            } else if( s.size == size_variable_bytes ) {
+               fc::unsigned_int len;
+               fc::raw::unpack( ds, len );
+               ds.skip( len.value );
+            } else if( s.size > 0 ) {
+               ds.skip( s.size );
+            } else {
+               abi.binary_to_variant( s.type, ds, max_time );
+            }
+         }
+         return fc::variant( std::move(result) );
+      }
+
+   private:
+      static constexpr int size_variable_bytes = -1;
+
+      struct step {
+         std::string name;
+         type_name   type;
+         bool        project;
+         int         size; // bytes to skip, size_variable_bytes for length prefixed types, 0 when it has to be decoded
+      };
+
+      static void flatten( const abi_serializer& abi, const type_name& type, std::vector<chain::field_def>& out ) {
+         const auto& st = abi.get_struct( abi.resolve_type(type) );
+         if( !st.base.empty() ) flatten( abi, st.base, out );
+         out.insert( out.end(), st.fields.begin(), st.fields.end() );
+      }
+
+      static int fixed_size( const type_name& t ) {
+         if( t == "bool" || t == "int8" || t == "uint8" ) return 1;
+         if( t == "int16" || t == "uint16" ) return 2;
+         if( t == "int32" || t == "uint32" || t == "float32" || t == "time_point_sec" || t == "block_timestamp_type" ) return 4;
+         if( t == "int64" || t == "uint64" || t == "float64" || t == "name" || t == "symbol" || t == "symbol_code" || t == "time_point" ) return 8;
+         if( t == "int128" || t == "uint128" || t == "float128" || t == "asset" ) return 16;
+         if( t == "checksum160" ) return 20;
+         if( t == "checksum256" ) return 32;
+         if( t == "checksum512" ) return 64;
+         if( t == "string" || t == "bytes" ) return size_variable_bytes;
+         return 0;
+      }
+
+      std::vector<step>        steps;
+      std::vector<std::string> missing;
+   };
+
+}
@@ -0,0 +1,208 @@
+/**
+ *  @file
+ *  @copyright eosauthority - free to use and modify - see LICENSE.txt
+ */
+#pragma once
+#include <eosio/chain/types.hpp>
+
+#include <boost/multi_index_container.hpp>
+#include <boost/multi_index/composite_key.hpp>
+#include <boost/multi_index/hashed_index.hpp>
+#include <boost/multi_index/member.hpp>
+#include <boost/multi_index/ordered_index.hpp>
+
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace eosio {
+
+   namespace bmi = boost::multi_index;
+   using chain::account_name;
+   using chain::transaction_id_type;
+
+   /**
+    * Bounded index of recently emitted actions, kept as their already encoded JSON so lookups only copy strings.
+    *
+    * Entries cover the reversible window plus @ref tail_blocks below the last irreversible block, and never more than
+    * @ref max_entries. Written from the main thread and read from the query thread, so every member takes the lock.
+    */
+   class recent_action_index {
+   public:
+      struct entry {
+         uint64_t            id;
+         transaction_id_type tx_id;
+         uint32_t            block_num;
+         account_name        account;
+         std::string         json;
+      };
+
+      struct by_id;
+      struct by_tx;
+      struct by_account;
+      struct by_block;
+      typedef bmi::multi_index_container<
+         entry,
+         bmi::indexed_by<
+            bmi::ordered_unique<bmi::tag<by_id>, bmi::member<entry, uint64_t, &entry::id>>,
+            bmi::hashed_non_unique<bmi::tag<by_tx>, bmi::member<entry, transaction_id_type, &entry::tx_id>, std::hash<transaction_id_type>>,
+            bmi::ordered_non_unique<bmi::tag<by_account>,
+               bmi::composite_key<entry,
+                  bmi::member<entry, account_name, &entry::account>,
+                  bmi::member<entry, uint32_t, &entry::block_num>
+               >
+            >,
+            bmi::ordered_non_unique<bmi::tag<by_block>, bmi::member<entry, uint32_t, &entry::block_num>>
+         >
+      > index_type;
+
+      uint32_t tail_blocks = 1200;
+      size_t   max_entries = 100000;
+
+      /// Drops entries at or above @ref block_num, which can only be left over from a block that was forked out
+      void start_block( uint32_t block_num ) {
+         std::lock_guard<std::mutex> g(mtx);
+         auto& idx = index.get<by_block>();
+         idx.erase( idx.lower_bound(block_num), idx.end() );
+      }
+
+      void add( uint32_t block_num, const transaction_id_type& tx_id, const account_name& account, std::string json ) {
+         std::lock_guard<std::mutex> g(mtx);
+         index.insert( entry{ next_id++, tx_id, block_num, account, std::move(json) } );
+         auto& idx = index.get<by_id>();
+         while( idx.size() > max_entries ) idx.erase( idx.begin() );
+      }
+
+      void prune( uint32_t irreversible_block_num ) {
+         if( irreversible_block_num <= tail_blocks ) return;
+         std::lock_guard<std::mutex> g(mtx);
+         auto& idx = index.get<by_block>();
+         idx.erase( idx.begin(), idx.lower_bound(irreversible_block_num - tail_blocks) );
+      }
+
+      std::vector<std::string> find_tx( const transaction_id_type& tx_id )const {
+         std::lock_guard<std::mutex> g(mtx);
+         std::vector<std::string> result;
+         auto range = index.get<by_tx>().equal_range(tx_id);
+         for( auto itr = range.first; itr != range.second; ++itr ) result.push_back(itr->json);
+         return result;
+      }
+
+      std::vector<std::string> find_account( const account_name& account, uint32_t from_block, size_t limit )const {
+         std::lock_guard<std::mutex> g(mtx);
+         std::vector<std::string> result;
+         const auto& idx = index.get<by_account>();
+         auto itr = idx.lower_bound( boost::make_tuple(account, from_block) );
+         auto end = idx.upper_bound( boost::make_tuple(account) );
+         for( ; itr != end && result.size() < limit; ++itr ) result.push_back(itr->json);
+         return result;
+      }
+
+      std::vector<std::string> find_block( uint32_t block_num )const {
+         std::lock_guard<std::mutex> g(mtx);
+         std::vector<std::string> result;
+         auto range = index.get<by_block>().equal_range(block_num);
+         for( auto itr = range.first; itr != range.second; ++itr ) result.push_back(itr->json);
+         return result;
+      }
+
+   private:
+      mutable std::mutex mtx;
+      index_type         index;
+      uint64_t           next_id = 0;
+   };
+
+   /**
+    * Finality of emitted transactions: tx id to the block that included it and whether that block is irreversible.
+    *
+    * Reversible entries are replaced when their height is accepted again after a fork and dropped once a block at or
+    * above their height turns irreversible without them. Irreversible entries are kept for @ref tail_blocks.
+    */
+   class tx_finality_index {
+   public:
+      struct entry {
+         transaction_id_type tx_id;
+         uint32_t            block_num;
+         bool                irreversible;
+      };
+
+      struct status {
+         bool     known = false;
+         uint32_t block_num = 0;
+         bool     irreversible = false;
+      };
+
+      struct by_tx;
+      struct by_block;
+      typedef bmi::multi_index_container<
+         entry,
+         bmi::indexed_by<
+            bmi::hashed_unique<bmi::tag<by_tx>, bmi::member<entry, transaction_id_type, &entry::tx_id>, std::hash<transaction_id_type>>,
+            bmi::ordered_non_unique<bmi::tag<by_block>, bmi::member<entry, uint32_t, &entry::block_num>>
+         >
+      > index_type;
+
+      uint32_t tail_blocks = 1200;
+
+      void start_block( uint32_t block_num ) {
+         std::lock_guard<std::mutex> g(mtx);
+         auto& idx = index.get<by_block>();
+         idx.erase( idx.lower_bound(block_num), idx.end() );
+      }
+
+      void accepted( uint32_t block_num, const transaction_id_type& tx_id ) {
+         std::lock_guard<std::mutex> g(mtx);
+         auto& idx = index.get<by_tx>();
+         auto itr = idx.find(tx_id);
+         if( itr == idx.end() ) {
+            idx.insert( entry{ tx_id, block_num, false } );
+         } else if( !itr->irreversible ) {
+            idx.modify( itr, [&]( entry& e ) { e.block_num = block_num; } );
+         }
+      }
+
+      template<typename TxIds>
+      void irreversible( uint32_t block_num, const TxIds& tx_ids ) {
+         std::lock_guard<std::mutex> g(mtx);
+         auto& tx_idx = index.get<by_tx>();
+         for( const auto& id : tx_ids ) {
+            auto itr = tx_idx.find(id);
+            if( itr != tx_idx.end() && itr->block_num == block_num ) {
+               tx_idx.modify( itr, []( entry& e ) { e.irreversible = true; } );
+            }
+         }
+
+         // Lower heights were settled by earlier calls, so only this height can still hold forked out entries
+         auto& idx = index.get<by_block>();
+         auto range = idx.equal_range(block_num);
+         for( auto itr = range.first; itr != range.second; ) {
+            if( !itr->irreversible ) itr = idx.erase(itr);
+            else ++itr;
+         }
+         if( block_num > tail_blocks ) idx.erase( idx.begin(), idx.lower_bound(block_num - tail_blocks) );
+         last_irreversible = block_num;
+      }
+
+      template<typename TxIds>
+      std::vector<status> lookup( const TxIds& tx_ids, uint32_t& lib )const {
+         std::lock_guard<std::mutex> g(mtx);
+         std::vector<status> result;
+         result.reserve( tx_ids.size() );
+         const auto& idx = index.get<by_tx>();
+         for( const auto& id : tx_ids ) {
+            status st;
+            auto itr = idx.find(id);
+            if( itr != idx.end() ) st = status{ true, itr->block_num, itr->irreversible };
+            result.push_back(st);
+         }
+         lib = last_irreversible;
+         return result;
+      }
+
+   private:
+      mutable std::mutex mtx;
+      index_type         index;
+      uint32_t           last_irreversible = 0;
+   };
+
+}
@@ -0,0 +1,169 @@
+/**
+ *  @file
+ *  @copyright eosauthority - free to use and modify - see LICENSE.txt
+ *
+ *  SHA-256 of many short buffers, such as all transactions of a block, hashed one after the other. Uses the SHA
+ *  extensions (SHA-NI) when the CPU has them, checked once at runtime, and a portable implementation otherwise. The
+ *  portable one is slower than OpenSSL, so callers check sha256_accelerated() and use fc::sha256 when it is false.
+ */
+#pragma once
+#include <array>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <cpuid.h>
+#include <immintrin.h>
+#define WATCHER_SHA256_X86 1
+#endif
+
+namespace eosio {
+
+   namespace sha256_detail {
+
+      alignas(16) static const uint32_t round_constants[64] = {
+         0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+         0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+         0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+         0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+         0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+         0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+         0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+         0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+      };
+
+      static const uint32_t initial_state[8] = {
+         0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+      };
+
+      inline uint32_t rotr( uint32_t x, int n ) { return (x >> n) | (x << (32 - n)); }
+
+      inline void compress_portable( uint32_t state[8], const uint8_t* data, size_t blocks ) {
+         uint32_t w[64];
+         for( ; blocks > 0; --blocks, data += 64 ) {
+            for( int i = 0; i < 16; ++i ) {
+               w[i] = uint32_t(data[4 * i]) << 24 | uint32_t(data[4 * i + 1]) << 16 | uint32_t(data[4 * i + 2]) << 8 | data[4 * i + 3];
+            }
+            for( int i = 16; i < 64; ++i ) {
+               const uint32_t s0 = rotr(w[i - 15], 7) ^ rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+               const uint32_t s1 = rotr(w[i - 2], 17) ^ rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+               w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+            }
+            uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+            uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+            for( int i = 0; i < 64; ++i ) {
+               const uint32_t t1 = h + (rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25)) + ((e & f) ^ (~e & g)) + round_constants[i] + w[i];
+               const uint32_t t2 = (rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+               h = g; g = f; f = e; e = d + t1;
+               d = c; c = b; b = a; a = t1 + t2;
+            }
+            state[0] += a; state[1] += b; state[2] += c; state[3] += d;
+            state[4] += e; state[5] += f; state[6] += g; state[7] += h;
+         }
+      }
+
+#ifdef WATCHER_SHA256_X86
+      /// One message block is 16 groups of 4 rounds, each taking the schedule words of the group in one register
+      __attribute__((target("sha,ssse3,sse4.1")))
+      inline void compress_sha_ni( uint32_t state[8], const uint8_t* data, size_t blocks ) {
+         const __m128i byte_swap = _mm_set_epi64x( 0x0c0d0e0f08090a0bull, 0x0405060700010203ull );
+         __m128i tmp = _mm_shuffle_epi32( _mm_loadu_si128(reinterpret_cast<const __m128i*>(&state[0])), 0xb1 ); // CDAB
+         __m128i state1 = _mm_shuffle_epi32( _mm_loadu_si128(reinterpret_cast<const __m128i*>(&state[4])), 0x1b ); // EFGH
+         __m128i state0 = _mm_alignr_epi8( tmp, state1, 8 );      // ABEF
+         state1 = _mm_blend_epi16( state1, tmp, 0xf0 );           // CDGH
+
+         for( ; blocks > 0; --blocks, data += 64 ) {
+            const __m128i abef = state0;
+            const __m128i cdgh = state1;
+            __m128i w[4];
+            for( int i = 0; i < 16; ++i ) {
+               __m128i& cur = w[i & 3];
+               if( i < 4 ) {
+                  cur = _mm_shuffle_epi8( _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 16 * i)), byte_swap );
+               } else {
+                  // W[t] = W[t-16] + s0(W[t-15]) + W[t-7] + s1(W[t-2])
+                  cur = _mm_sha256msg1_epu32( cur, w[(i + 1) & 3] );
+                  cur = _mm_add_epi32( cur, _mm_alignr_epi8(w[(i + 3) & 3], w[(i + 2) & 3], 4) );
+                  cur = _mm_sha256msg2_epu32( cur, w[(i + 3) & 3] );
+               }
+               __m128i msg = _mm_add_epi32( cur, _mm_load_si128(reinterpret_cast<const __m128i*>(&round_constants[4 * i])) );
+               state1 = _mm_sha256rnds2_epu32( state1, state0, msg );
+               state0 = _mm_sha256rnds2_epu32( state0, state1, _mm_shuffle_epi32(msg, 0x0e) );
+            }
+            state0 = _mm_add_epi32( state0, abef );
+            state1 = _mm_add_epi32( state1, cdgh );
+         }
+
+         tmp = _mm_shuffle_epi32( state0, 0x1b );                 // FEBA
+         state1 = _mm_shuffle_epi32( state1, 0xb1 );              // DCHG
+         _mm_storeu_si128( reinterpret_cast<__m128i*>(&state[0]), _mm_blend_epi16(tmp, state1, 0xf0) );  // DCBA
+         _mm_storeu_si128( reinterpret_cast<__m128i*>(&state[4]), _mm_alignr_epi8(state1, tmp, 8) );     // ABEF
+      }
+
+      inline bool cpu_has_sha_ni() {
+         unsigned eax, ebx, ecx, edx;
+         if( !__get_cpuid(1, &eax, &ebx, &ecx, &edx) ) return false;
+         const bool ssse3_sse41 = (ecx & bit_SSSE3) && (ecx & bit_SSE4_1);
+         if( !__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx) ) return false;
+         return ssse3_sse41 && (ebx & (1u << 29));
+      }
+#endif
+
+      typedef void (*compress_fn)( uint32_t state[8], const uint8_t* data, size_t blocks );
+
+      inline compress_fn select_compress() {
+#ifdef WATCHER_SHA256_X86
+         if( cpu_has_sha_ni() ) return &compress_sha_ni;
+#endif
+         return &compress_portable;
+      }
+
+      inline compress_fn compress() {
+         static const compress_fn fn = select_compress();
+         return fn;
+      }
+
+      inline void hash( compress_fn fn, const char* data, size_t len, char digest[32] ) {
+         uint32_t state[8];
+         memcpy( state, initial_state, sizeof(state) );
+         const size_t full = len / 64;
+         if( full ) fn( state, reinterpret_cast<const uint8_t*>(data), full );
+
+         // Padding: 0x80, zeros, then the message length in bits, big endian, filling one or two blocks
+         uint8_t tail[128] = {};
+         const size_t rest = len - full * 64;
+         memcpy( tail, data + full * 64, rest );
+         tail[rest] = 0x80;
+         const size_t tail_len = rest < 56 ? 64 : 128;
+         const uint64_t bits = uint64_t(len) * 8;
+         for( int i = 0; i < 8; ++i ) tail[tail_len - 1 - i] = uint8_t(bits >> (8 * i));
+         fn( state, tail, tail_len / 64 );
+
+         for( int i = 0; i < 8; ++i ) {
+            digest[4 * i] = char(state[i] >> 24);
+            digest[4 * i + 1] = char(state[i] >> 16);
+            digest[4 * i + 2] = char(state[i] >> 8);
+            digest[4 * i + 3] = char(state[i]);
+         }
+      }
+   }
+
+   struct sha256_input {
+      const char* data;
+      size_t      size;
+   };
+
+   /// True if hashing runs on the SHA extensions
+   inline bool sha256_accelerated() {
+      return sha256_detail::compress() != &sha256_detail::compress_portable;
+   }
+
+   /// Hashes @ref count buffers into @ref digests, 32 bytes each, in turn; the kernel is looked up once for all of them
+   inline void sha256_batch( const sha256_input* inputs, size_t count, char (*digests)[32] ) {
+      const auto fn = sha256_detail::compress();
+      for( size_t i = 0; i < count; ++i ) {
+         sha256_detail::hash( fn, inputs[i].data, inputs[i].size, digests[i] );
+      }
+   }
+
+}
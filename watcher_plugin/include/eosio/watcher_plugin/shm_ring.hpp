@@ -0,0 +1,253 @@
+/**
+ *  @file
+ *  @copyright eosauthority - free to use and modify - see LICENSE.txt
+ *
+ *  Single-producer/single-consumer frame ring in POSIX shared memory (/dev/shm), for consumers running on the same
+ *  host as nodeos. The plugin owns the writer; consumers only need this header (and -lrt on older glibc) to read
+ *  frames in place.
+ *
+ *  Layout: a shm_ring_header followed by `capacity` data bytes. Each record is an 8 byte aligned
+ *  { uint32_t length; uint32_t flags; payload } that never wraps; when a record doesn't fit before the end of the
+ *  buffer a padding record fills the rest and the frame starts again at offset 0. Both sides park on futexes in the
+ *  shared header instead of spinning.
+ */
+#pragma once
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+namespace eosio {
+
+   struct shm_ring_header {
+      static constexpr uint64_t magic_value = 0x474e495248435457ull; // "WTCHRING"
+      static constexpr uint32_t version_value = 1;
+
+      uint64_t              magic;
+      uint32_t              version;
+      uint32_t              reserved;
+      uint64_t              capacity;
+
+      alignas(64) std::atomic<uint64_t> write_pos;      // total bytes published
+      std::atomic<uint32_t>             write_seq;      // futex word, bumped after every publish
+      std::atomic<uint32_t>             reader_waiting;
+      std::atomic<uint32_t>             closed;
+
+      alignas(64) std::atomic<uint64_t> read_pos;       // total bytes released by the consumer
+      std::atomic<uint32_t>             read_seq;       // futex word, bumped after every release
+      std::atomic<uint32_t>             writer_waiting;
+   };
+
+   namespace shm_ring_detail {
+      constexpr uint32_t flag_padding = 1;
+      constexpr uint64_t record_header = 8;
+
+      inline uint64_t record_size( uint64_t len ) { return (record_header + len + 7) & ~uint64_t(7); }
+
+      inline void futex_wait( std::atomic<uint32_t>& word, uint32_t expected, uint32_t timeout_ms ) {
+         timespec ts{ timeout_ms / 1000, long(timeout_ms % 1000) * 1000000 };
+         syscall( SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAIT, expected, &ts, nullptr, 0 );
+      }
+
+      inline void futex_wake( std::atomic<uint32_t>& word ) {
+         syscall( SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAKE, INT32_MAX, nullptr, nullptr, 0 );
+      }
+
+      /// Maps the segment, @ref size 0 maps an existing one whole; the mapped length is stored in @ref mapped
+      inline shm_ring_header* map( const std::string& name, int flags, uint64_t size, uint64_t* mapped = nullptr ) {
+         int fd = shm_open( name.c_str(), flags, 0600 );
+         if( fd < 0 ) throw std::runtime_error( "shm_open " + name + ": " + strerror(errno) );
+         if( size == 0 ) {
+            struct stat st;
+            if( fstat(fd, &st) != 0 || uint64_t(st.st_size) < sizeof(shm_ring_header) ) {
+               close(fd);
+               throw std::runtime_error( "shm ring " + name + " is not initialized" );
+            }
+            size = st.st_size;
+         } else if( ftruncate(fd, size) != 0 ) {
+            close(fd);
+            throw std::runtime_error( "ftruncate " + name + ": " + strerror(errno) );
+         }
+         void* p = mmap( nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 );
+         close(fd);
+         if( p == MAP_FAILED ) throw std::runtime_error( "mmap " + name + ": " + strerror(errno) );
+         if( mapped ) *mapped = size;
+         return static_cast<shm_ring_header*>(p);
+      }
+   }
+
+   /**
+    * Producer side. write() blocks while the consumer is too far behind, like a ZMQ push to a full pipe,
+    * so nothing is dropped and frames keep their order.
+    */
+   class shm_ring_writer {
+   public:
+      /// Creates (or recreates) the segment @ref name, e.g. "/eosio-watcher", with @ref capacity data bytes
+      shm_ring_writer( const std::string& name, uint64_t capacity ) : name(name) {
+         if( capacity < 4096 || (capacity & 7) ) throw std::invalid_argument( "shm ring capacity must be a multiple of 8 and at least 4096" );
+         shm_unlink( name.c_str() );
+         hdr = shm_ring_detail::map( name, O_CREAT | O_EXCL | O_RDWR, sizeof(shm_ring_header) + capacity );
+         hdr->capacity = capacity;
+         hdr->write_pos = 0;
+         hdr->write_seq = 0;
+         hdr->reader_waiting = 0;
+         hdr->closed = 0;
+         hdr->read_pos = 0;
+         hdr->read_seq = 0;
+         hdr->writer_waiting = 0;
+         hdr->version = shm_ring_header::version_value;
+         std::atomic_thread_fence( std::memory_order_release );
+         hdr->magic = shm_ring_header::magic_value;
+         data = reinterpret_cast<char*>(hdr + 1);
+      }
+
+      ~shm_ring_writer() {
+         hdr->closed.store( 1, std::memory_order_release );
+         hdr->write_seq.fetch_add( 1, std::memory_order_release );
+         shm_ring_detail::futex_wake( hdr->write_seq );
+         munmap( hdr, sizeof(shm_ring_header) + hdr->capacity );
+         shm_unlink( name.c_str() );
+      }
+
+      shm_ring_writer( const shm_ring_writer& ) = delete;
+      shm_ring_writer& operator=( const shm_ring_writer& ) = delete;
+
+      uint64_t capacity()const { return hdr->capacity; }
+
+      /// Bytes published but not yet released by the consumer
+      uint64_t depth()const {
+         return hdr->write_pos.load(std::memory_order_relaxed) - hdr->read_pos.load(std::memory_order_acquire);
+      }
+
+      void write( const char* payload, uint64_t len ) {
+         using namespace shm_ring_detail;
+         const uint64_t cap = hdr->capacity;
+         const uint64_t need = record_size(len);
+         if( need > cap / 2 ) throw std::length_error( "frame larger than half the shm ring" );
+
+         const uint64_t wp = hdr->write_pos.load( std::memory_order_relaxed );
+         const uint64_t offset = wp % cap;
+         const uint64_t pad = cap - offset < need ? cap - offset : 0;
+         wait_for_space( wp, pad + need );
+
+         uint64_t pos = wp;
+         if( pad ) {
+            put_header( pos % cap, uint32_t(pad - record_header), flag_padding );
+            pos += pad;
+         }
+         put_header( pos % cap, uint32_t(len), 0 );
+         memcpy( data + pos % cap + record_header, payload, len );
+         pos += need;
+
+         hdr->write_pos.store( pos, std::memory_order_release );
+         hdr->write_seq.fetch_add( 1, std::memory_order_release );
+         if( hdr->reader_waiting.load(std::memory_order_acquire) ) futex_wake( hdr->write_seq );
+      }
+
+   private:
+      void put_header( uint64_t offset, uint32_t len, uint32_t flags ) {
+         memcpy( data + offset, &len, sizeof(len) );
+         memcpy( data + offset + 4, &flags, sizeof(flags) );
+      }
+
+      void wait_for_space( uint64_t wp, uint64_t total ) {
+         const uint64_t cap = hdr->capacity;
+         while( true ) {
+            const uint32_t seq = hdr->read_seq.load( std::memory_order_acquire );
+            if( cap - (wp - hdr->read_pos.load(std::memory_order_acquire)) >= total ) return;
+            hdr->writer_waiting.store( 1, std::memory_order_release );
+            // The timeout only guards against a consumer that died between releasing space and waking us
+            shm_ring_detail::futex_wait( hdr->read_seq, seq, 100 );
+            hdr->writer_waiting.store( 0, std::memory_order_release );
+         }
+      }
+
+      std::string      name;
+      shm_ring_header* hdr = nullptr;
+      char*            data = nullptr;
+   };
+
+   /**
+    * Consumer side. Frames are handed to the callback as pointers into the shared segment and released after it
+    * returns, so nothing is copied; the callback must not keep the pointer.
+    */
+   class shm_ring_reader {
+   public:
+      explicit shm_ring_reader( const std::string& name ) {
+         hdr = shm_ring_detail::map( name, O_RDWR, 0, &mapped_size );
+         if( hdr->magic != shm_ring_header::magic_value || hdr->version != shm_ring_header::version_value ||
+             hdr->capacity > mapped_size - sizeof(shm_ring_header) ) {
+            munmap( hdr, mapped_size );
+            throw std::runtime_error( "shm ring " + name + " has an unexpected format" );
+         }
+         std::atomic_thread_fence( std::memory_order_acquire );
+         data = reinterpret_cast<const char*>(hdr + 1);
+      }
+
+      ~shm_ring_reader() { munmap( hdr, mapped_size ); }
+
+      shm_ring_reader( const shm_ring_reader& ) = delete;
+      shm_ring_reader& operator=( const shm_ring_reader& ) = delete;
+
+      /// True once the producer has gone away and every frame has been consumed
+      bool finished()const {
+         return hdr->closed.load(std::memory_order_acquire) &&
+                hdr->read_pos.load(std::memory_order_relaxed) == hdr->write_pos.load(std::memory_order_acquire);
+      }
+
+      /// Calls @ref f(const char* data, uint32_t len) for up to @ref max_frames available frames, returns how many were read
+      template<typename F>
+      size_t poll( F&& f, size_t max_frames = SIZE_MAX ) {
+         using namespace shm_ring_detail;
+         const uint64_t cap = hdr->capacity;
+         const uint64_t wp = hdr->write_pos.load( std::memory_order_acquire );
+         uint64_t rp = hdr->read_pos.load( std::memory_order_relaxed );
+         size_t frames = 0;
+         while( rp != wp && frames < max_frames ) {
+            uint32_t len, flags;
+            memcpy( &len, data + rp % cap, sizeof(len) );
+            memcpy( &flags, data + rp % cap + 4, sizeof(flags) );
+            if( !(flags & flag_padding) ) {
+               f( data + rp % cap + record_header, len );
+               ++frames;
+            }
+            rp += record_size(len);
+            // Release per frame so a blocked producer can make progress while a long batch is processed
+            hdr->read_pos.store( rp, std::memory_order_release );
+            hdr->read_seq.fetch_add( 1, std::memory_order_release );
+            if( hdr->writer_waiting.load(std::memory_order_acquire) ) futex_wake( hdr->read_seq );
+         }
+         return frames;
+      }
+
+      /// Parks until a frame is published or @ref timeout_ms elapses; returns true if frames are available
+      bool wait( uint32_t timeout_ms ) {
+         const uint32_t seq = hdr->write_seq.load( std::memory_order_acquire );
+         if( available() ) return true;
+         hdr->reader_waiting.store( 1, std::memory_order_release );
+         if( !available() ) shm_ring_detail::futex_wait( hdr->write_seq, seq, timeout_ms );
+         hdr->reader_waiting.store( 0, std::memory_order_release );
+         return available();
+      }
+
+   private:
+      bool available()const {
+         return hdr->write_pos.load(std::memory_order_acquire) != hdr->read_pos.load(std::memory_order_relaxed);
+      }
+
+      shm_ring_header* hdr = nullptr;
+      const char*      data = nullptr;
+      uint64_t         mapped_size = 0;
+   };
+
+}
@@ -0,0 +1,108 @@
+/**
+ *  @file
+ *  @copyright eosauthority - free to use and modify - see LICENSE.txt
+ */
+#pragma once
+#include <eosio/watcher_plugin/sha256_batch.hpp>
+#include <eosio/chain/block.hpp>
+
+#include <fc/crypto/sha256.hpp>
+
+#include <vector>
+
+namespace eosio {
+
+   namespace transaction_ids_detail {
+
+      /// Reads a varuint32, failing on anything fc::raw::pack wouldn't have produced
+      inline bool read_varint( const char*& p, const char* end, uint32_t& value ) {
+         value = 0;
+         for( int shift = 0; shift < 35; shift += 7 ) {
+            if( p == end ) return false;
+            const uint8_t b = *p++;
+            if( shift == 28 && b > 0x0f ) return false;
+            value |= uint32_t(b & 0x7f) << shift;
+            if( !(b & 0x80) ) return b != 0 || shift == 0;
+         }
+         return false;
+      }
+
+      inline bool skip( const char*& p, const char* end, uint64_t n ) {
+         if( uint64_t(end - p) < n ) return false;
+         p += n;
+         return true;
+      }
+
+      inline bool skip_actions( const char*& p, const char* end ) {
+         uint32_t count, n;
+         if( !read_varint(p, end, count) ) return false;
+         for( uint32_t i = 0; i < count; ++i ) {
+            if( !skip(p, end, 16) ) return false;                                          // account, name
+            if( !read_varint(p, end, n) || !skip(p, end, uint64_t(n) * 16) ) return false; // authorization
+            if( !read_varint(p, end, n) || !skip(p, end, n) ) return false;                // data
+         }
+         return true;
+      }
+   }
+
+   /**
+    * True if @ref packed is exactly fc::raw::pack() of the transaction it unpacks to, i.e. every varint is minimal and
+    * nothing trails it. Only then is its SHA-256 the transaction id; fc's unpack also accepts overlong varints and
+    * trailing bytes, which would change the hash but not the transaction.
+    */
+   inline bool is_canonical_transaction( const chain::bytes& packed ) {
+      using namespace transaction_ids_detail;
+      const char* p = packed.data();
+      const char* end = p + packed.size();
+      uint32_t n;
+      if( !skip(p, end, 10) ) return false;                      // expiration, ref_block_num, ref_block_prefix
+      if( !read_varint(p, end, n) ) return false;                // max_net_usage_words
+      if( !skip(p, end, 1) ) return false;                       // max_cpu_usage_ms
+      if( !read_varint(p, end, n) ) return false;                // delay_sec
+      if( !skip_actions(p, end) ) return false;                  // context_free_actions
+      if( !skip_actions(p, end) ) return false;                  // actions
+      uint32_t extensions;
+      if( !read_varint(p, end, extensions) ) return false;
+      for( uint32_t i = 0; i < extensions; ++i ) {
+         if( !skip(p, end, 2) || !read_varint(p, end, n) || !skip(p, end, n) ) return false;
+      }
+      return p == end;
+   }
+
+   /**
+    * Ids of all transactions of @ref block, in block order. Uncompressed canonical transactions are hashed straight
+    * from their packed bytes, with sha256_batch on CPUs with the SHA extensions and with fc::sha256 (OpenSSL) on the
+    * others, where the portable kernel is slower; the rest go through packed_transaction::id().
+    */
+   inline void block_transaction_ids( const chain::signed_block& block, std::vector<chain::transaction_id_type>& ids ) {
+      ids.resize( block.transactions.size() );
+      const bool batch = sha256_accelerated();
+      std::vector<sha256_input> inputs;
+      std::vector<size_t> positions;
+      inputs.reserve( block.transactions.size() );
+      positions.reserve( block.transactions.size() );
+      for( size_t i = 0; i < block.transactions.size(); ++i ) {
+         const auto& trx = block.transactions[i].trx;
+         if( trx.contains<chain::transaction_id_type>() ) {
+            ids[i] = trx.get<chain::transaction_id_type>();
+            continue;
+         }
+         const auto& pt = trx.get<chain::packed_transaction>();
+         if( pt.compression != chain::packed_transaction::none || !is_canonical_transaction(pt.packed_trx) ) {
+            ids[i] = pt.id();
+         } else if( !batch ) {
+            ids[i] = fc::sha256::hash( pt.packed_trx.data(), pt.packed_trx.size() );
+         } else {
+            inputs.push_back( sha256_input{ pt.packed_trx.data(), pt.packed_trx.size() } );
+            positions.push_back( i );
+         }
+      }
+      if( inputs.empty() ) return;
+      std::vector<std::array<char, 32>> digests( inputs.size() );
+      sha256_batch( inputs.data(), inputs.size(), reinterpret_cast<char(*)[32]>(digests.data()) );
+      for( size_t j = 0; j < positions.size(); ++j ) {
+         memcpy( ids[positions[j]].data(), digests[j].data(), 32 );
+      }
+   }
+
+}
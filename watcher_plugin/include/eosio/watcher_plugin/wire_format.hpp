@@ -0,0 +1,75 @@
+/**
+ *  @file
+ *  @copyright eosauthority - free to use and modify - see LICENSE.txt
+ */
+#pragma once
+#include <eosio/watcher_plugin/json_writer.hpp>
+
+#include <fc/io/datastream.hpp>
+#include <fc/io/raw.hpp>
+#include <fc/io/raw_variant.hpp>
+
+#include <boost/iostreams/device/back_inserter.hpp>
+#include <boost/iostreams/filter/zlib.hpp>
+#include <boost/iostreams/filtering_stream.hpp>
+
+#include <stdexcept>
+#include <string>
+
+namespace eosio {
+
+   /**
+    * Encoding of the frames the plugin sends:
+    *  - json:   the message as JSON, see json_writer
+    *  - binary: msg_type as a little endian uint32, then fc::raw::pack() of the message
+    *  - zlib:   the JSON frame, zlib compressed
+    */
+   enum class wire_format { json, binary, zlib };
+
+   inline wire_format parse_wire_format( const std::string& s ) {
+      if( s == "json" ) return wire_format::json;
+      if( s == "binary" ) return wire_format::binary;
+      if( s == "zlib" ) return wire_format::zlib;
+      throw std::invalid_argument( "wire format must be json, binary or zlib" );
+   }
+
+   template<wire_format Format>
+   struct frame_encoder;
+
+   template<>
+   struct frame_encoder<wire_format::json> {
+      template<typename T>
+      static std::string encode( const T& msg ) { return to_json( msg ); }
+   };
+
+   template<>
+   struct frame_encoder<wire_format::binary> {
+      template<typename T>
+      static std::string encode( const T& msg ) {
+         const uint32_t type = msg.msg_type;
+         std::string out( sizeof(type) + fc::raw::pack_size(msg), '\0' );
+         fc::datastream<char*> ds( &out[0], out.size() );
+         fc::raw::pack( ds, type );
+         fc::raw::pack( ds, msg );
+         return out;
+      }
+   };
+
+   template<>
+   struct frame_encoder<wire_format::zlib> {
+      template<typename T>
+      static std::string encode( const T& msg ) {
+         namespace bio = boost::iostreams;
+         const std::string json = to_json( msg );
+         std::string out;
+         out.reserve( json.size() / 3 );
+         bio::filtering_ostream comp;
+         comp.push( bio::zlib_compressor(bio::zlib::best_speed) );
+         comp.push( bio::back_inserter(out) );
+         bio::write( comp, json.data(), json.size() );
+         bio::close( comp );
+         return out;
+      }
+   };
+
+}
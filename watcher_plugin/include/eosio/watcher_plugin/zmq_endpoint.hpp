@@ -0,0 +1,330 @@
+/**
+ *  @file
+ *  @copyright eosauthority - free to use and modify - see LICENSE.txt
+ */
+#pragma once
+#include <zmq.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace eosio {
+
+   typedef std::shared_ptr<const std::string> shared_frame;
+
+   /**
+    * One PUSH socket with its own bounded queue and sender thread, so a slow consumer on one endpoint never delays
+    * another endpoint or the thread producing frames (unless its overflow policy is block and its queue is full).
+    * Frames are shared between endpoints and handed to ZMQ without copying.
+    *
+    * Peers are tracked with a socket monitor, and ZMTP heartbeats turn a hung consumer into a disconnect. While no
+    * peer is attached push() appends to a bounded spool instead of the queue, so a dead consumer never blocks the
+    * producer; the spool is drained in order before anything else once a consumer attaches again. A full spool drops
+    * its oldest frames, counted by spool_dropped() and reported to on_attach_change when a consumer attaches.
+    *
+    * The queue is split into priority lanes, lane 0 first. Each lane is bounded on its own and keeps its frames in
+    * order, and the sender always takes the next frame from the highest priority non-empty lane.
+    *
+    * On destruction what is still queued for an attached consumer is sent for up to drain_ms, and the socket lingers
+    * as long again so ZMQ can flush it. Frames spooled for a detached endpoint are lost then.
+    */
+   class zmq_endpoint {
+   public:
+      enum class overflow_policy { block, drop_oldest, drop_newest };
+
+      struct config {
+         std::string     bind;
+         size_t          queue_size = 1000;     // per lane
+         size_t          lanes = 1;
+         overflow_policy overflow = overflow_policy::block;
+         int             heartbeat_ms = 1000;   // 0 disables heartbeats
+         size_t          spool_size = 100000;   // frames kept while detached, the oldest are dropped beyond this
+         int             drain_ms = 2000;       // time to send what is queued on shutdown
+         // Called from the sender thread; on attach @ref spool_dropped is the number of frames the spool lost meanwhile
+         std::function<void(const std::string& bind, bool attached, uint64_t spool_dropped)> on_attach_change;
+      };
+
+      static overflow_policy parse_overflow( const std::string& s ) {
+         if( s == "block" ) return overflow_policy::block;
+         if( s == "drop-oldest" ) return overflow_policy::drop_oldest;
+         if( s == "drop-newest" ) return overflow_policy::drop_newest;
+         throw std::invalid_argument( "overflow must be block, drop-oldest or drop-newest" );
+      }
+
+      /// Parses `endpoint[;queue=N][;overflow=block|drop-oldest|drop-newest]`
+      static config parse( const std::string& spec, const config& defaults ) {
+         config c = defaults;
+         size_t start = 0, end;
+         bool first = true;
+         do {
+            end = spec.find(';', start);
+            const std::string part = spec.substr( start, end == std::string::npos ? std::string::npos : end - start );
+            if( first ) {
+               c.bind = part;
+               first = false;
+            } else if( part.compare(0, 6, "queue=") == 0 ) {
+               c.queue_size = std::stoul( part.substr(6) );
+            } else if( part.compare(0, 9, "overflow=") == 0 ) {
+               c.overflow = parse_overflow( part.substr(9) );
+            } else {
+               throw std::invalid_argument( "unknown endpoint option " + part );
+            }
+            start = end + 1;
+         } while( end != std::string::npos );
+         if( c.bind.empty() || c.queue_size == 0 ) throw std::invalid_argument( "endpoint needs an address and a queue size > 0" );
+         return c;
+      }
+
+      zmq_endpoint( zmq::context_t& context, const config& c )
+      : cfg(c), socket(context, ZMQ_PUSH), monitor(context, ZMQ_PAIR), queues(std::max<size_t>(c.lanes, 1)) {
+         int linger = std::max( cfg.drain_ms, 1 );
+         socket.setsockopt( ZMQ_LINGER, &linger, sizeof(linger) );
+#ifdef ZMQ_HEARTBEAT_IVL
+         if( cfg.heartbeat_ms > 0 ) {
+            int timeout = cfg.heartbeat_ms * 3;
+            socket.setsockopt( ZMQ_HEARTBEAT_IVL, &cfg.heartbeat_ms, sizeof(cfg.heartbeat_ms) );
+            socket.setsockopt( ZMQ_HEARTBEAT_TIMEOUT, &timeout, sizeof(timeout) );
+            socket.setsockopt( ZMQ_HEARTBEAT_TTL, &timeout, sizeof(timeout) );
+         }
+#endif
+         const std::string monitor_addr = "inproc://watcher-endpoint-monitor-" + std::to_string( next_monitor_id()++ );
+         if( zmq_socket_monitor( static_cast<void*>(socket), monitor_addr.c_str(),
+                                 ZMQ_EVENT_ACCEPTED | ZMQ_EVENT_DISCONNECTED ) != 0 )
+            throw zmq::error_t();
+         monitor.connect( monitor_addr );
+         socket.bind( cfg.bind );
+         sender = std::thread( [this]() { run(); } );
+      }
+
+      ~zmq_endpoint() {
+         {
+            std::lock_guard<std::mutex> g(mtx);
+            drain_until = std::chrono::steady_clock::now() + std::chrono::milliseconds( std::max(cfg.drain_ms, 0) );
+            closing = true;
+         }
+         not_empty.notify_all();
+         not_full.notify_all();
+         sender.join();
+      }
+
+      zmq_endpoint( const zmq_endpoint& ) = delete;
+      zmq_endpoint& operator=( const zmq_endpoint& ) = delete;
+
+      const std::string& address()const { return cfg.bind; }
+      size_t capacity()const { return cfg.queue_size; }
+      /// Frames dropped by the overflow policy or by a full spool
+      uint64_t dropped()const { return dropped_frames; }
+      /// Frames dropped by a full spool while no consumer was attached
+      uint64_t spool_dropped()const { return spool_dropped_frames; }
+      bool attached()const { return is_attached; }
+
+      size_t depth()const {
+         std::lock_guard<std::mutex> g(mtx);
+         size_t total = 0;
+         for( const auto& q : queues ) total += q.size();
+         return total;
+      }
+
+      /// Fill ratio of the fullest lane
+      double fill()const {
+         std::lock_guard<std::mutex> g(mtx);
+         size_t deepest = 0;
+         for( const auto& q : queues ) deepest = std::max( deepest, q.size() );
+         return double(deepest) / cfg.queue_size;
+      }
+
+      size_t spooled()const {
+         std::lock_guard<std::mutex> g(mtx);
+         return spool.size();
+      }
+
+      /// Lanes beyond the configured number are folded into the lowest priority lane
+      void push( const shared_frame& frame, size_t lane = SIZE_MAX ) {
+         std::unique_lock<std::mutex> g(mtx);
+         if( !is_attached ) {
+            append_to_spool( frame );
+            return;
+         }
+         auto& queue = queues[ std::min( lane, queues.size() - 1 ) ];
+         if( queue.size() >= cfg.queue_size ) {
+            switch( cfg.overflow ) {
+               case overflow_policy::block:
+                  not_full.wait( g, [&]() { return queue.size() < cfg.queue_size || !is_attached || closing; } );
+                  if( !is_attached ) {
+                     append_to_spool( frame );
+                     return;
+                  }
+                  break;
+               case overflow_policy::drop_oldest:
+                  queue.pop_front();
+                  ++dropped_frames;
+                  break;
+               case overflow_policy::drop_newest:
+                  ++dropped_frames;
+                  return;
+            }
+         }
+         queue.push_back( frame );
+         g.unlock();
+         not_empty.notify_one();
+      }
+
+   private:
+      static void release_frame( void*, void* hint ) {
+         delete static_cast<shared_frame*>(hint);
+      }
+
+      static std::atomic<uint64_t>& next_monitor_id() {
+         static std::atomic<uint64_t> id{0};
+         return id;
+      }
+
+      /// Once draining the queue on shutdown has taken too long
+      bool stopping()const {
+         return closing && std::chrono::steady_clock::now() >= drain_until;
+      }
+
+      /// Requires mtx
+      void append_to_spool( const shared_frame& frame ) {
+         spool.push_back( frame );
+         while( spool.size() > cfg.spool_size ) {
+            spool.pop_front();
+            ++dropped_frames;
+            ++spool_dropped_frames;
+         }
+      }
+
+      /// Reads pending monitor events and updates the peer count and attached state
+      void handle_monitor_events() {
+         zmq::message_t event, addr;
+         while( monitor.recv( &event, ZMQ_DONTWAIT ) ) {
+            if( event.more() ) monitor.recv( &addr );
+            if( event.size() < sizeof(uint16_t) ) continue;
+            uint16_t id;
+            memcpy( &id, event.data(), sizeof(id) );
+            if( id == ZMQ_EVENT_ACCEPTED ) ++peers;
+            else if( id == ZMQ_EVENT_DISCONNECTED && peers > 0 ) --peers;
+         }
+         set_attached( peers > 0 );
+      }
+
+      void set_attached( bool a ) {
+         if( a == is_attached ) return;
+         uint64_t lost = 0;
+         {
+            std::lock_guard<std::mutex> g(mtx);
+            is_attached = a;
+            lost = spool_dropped_frames - spool_dropped_at_detach;
+            if( !a ) {
+               spool_dropped_at_detach = spool_dropped_frames;
+               // Whatever is queued for the vanished consumer is spooled so the producer is released right away
+               for( auto& queue : queues ) {
+                  for( auto& f : queue ) append_to_spool( f );
+                  queue.clear();
+               }
+            }
+         }
+         not_full.notify_all();
+         if( cfg.on_attach_change ) cfg.on_attach_change( cfg.bind, a, a ? lost : 0 );
+      }
+
+      /// Waits until the socket accepts the frame; gives up when the last peer detaches or on shutdown
+      bool send( const shared_frame& frame ) {
+         zmq::pollitem_t items[] = { { static_cast<void*>(socket), 0, ZMQ_POLLOUT, 0 },
+                                     { static_cast<void*>(monitor), 0, ZMQ_POLLIN, 0 } };
+         while( !stopping() ) {
+            zmq::poll( items, 2, 100 );
+            if( items[1].revents & ZMQ_POLLIN ) handle_monitor_events();
+            if( !is_attached ) return false;
+            if( !(items[0].revents & ZMQ_POLLOUT) ) continue;
+            auto* hint = new shared_frame(frame);
+            zmq::message_t message( const_cast<char*>(frame->data()), frame->size(), &zmq_endpoint::release_frame, hint );
+            if( socket.send( message, ZMQ_DONTWAIT ) ) return true;
+         }
+         return false;
+      }
+
+      /// Requires mtx
+      std::deque<shared_frame>* first_non_empty_lane() {
+         for( auto& q : queues ) {
+            if( !q.empty() ) return &q;
+         }
+         return nullptr;
+      }
+
+      /// Spooled frames first, they are older than anything queued
+      bool next_frame( shared_frame& frame ) {
+         std::unique_lock<std::mutex> g(mtx);
+         if( spool.empty() ) {
+            std::deque<shared_frame>* queue = nullptr;
+            not_empty.wait_for( g, std::chrono::milliseconds(100), [&]() { return (queue = first_non_empty_lane()) || closing; } );
+            if( !queue ) return false;
+            frame = std::move( queue->front() );
+            queue->pop_front();
+         } else {
+            frame = std::move( spool.front() );
+            spool.pop_front();
+         }
+         return true;
+      }
+
+      void run() {
+         zmq::pollitem_t items[] = { { static_cast<void*>(monitor), 0, ZMQ_POLLIN, 0 } };
+         try {
+            while( !stopping() ) {
+               if( !is_attached ) {
+                  // Nobody to drain the spool to on shutdown
+                  if( closing ) break;
+                  zmq::poll( items, 1, 100 );
+                  handle_monitor_events();
+                  continue;
+               }
+               shared_frame frame;
+               if( !next_frame(frame) ) {
+                  if( closing ) break;
+                  handle_monitor_events();
+                  continue;
+               }
+               not_full.notify_all();
+               if( !send(frame) && !stopping() ) {
+                  // The consumer went away mid-send, keep the frame at the head of the spool
+                  std::lock_guard<std::mutex> g(mtx);
+                  spool.push_front( std::move(frame) );
+               }
+            }
+         } catch( const zmq::error_t& ) {
+            // The context is being terminated
+         }
+      }
+
+      config                    cfg;
+      zmq::socket_t             socket;
+      zmq::socket_t             monitor;     // only used by the sender thread, as is peers
+      int                       peers = 0;
+      std::atomic<bool>         is_attached{false};
+      mutable std::mutex        mtx;
+      std::condition_variable   not_empty;
+      std::condition_variable   not_full;
+      std::vector<std::deque<shared_frame>> queues; // one per lane, highest priority first
+      std::deque<shared_frame>  spool;
+      std::atomic<bool>         closing{false};
+      std::chrono::steady_clock::time_point drain_until;   // set with closing, under mtx
+      std::atomic<uint64_t>     dropped_frames{0};
+      std::atomic<uint64_t>     spool_dropped_frames{0};
+      uint64_t                  spool_dropped_at_detach = 0;   // under mtx
+      std::thread               sender;
+   };
+
+}
@@ -0,0 +1,145 @@
+/**
+ *  @file
+ *  @copyright eosauthority - free to use and modify - see LICENSE.txt
+ *
+ *  Checks that json_writer renders every message type exactly like fc::json::to_string(). The relay, merger and
+ *  consumer library read the header at fixed positions, so the text has to match, not only the values. Prints where
+ *  each message type differs and exits with 1 if any does.
+ */
+#include <eosio/watcher_plugin/json_writer.hpp>
+#include <eosio/watcher_plugin/messages.hpp>
+
+#include <fc/io/json.hpp>
+#include <fc/variant_object.hpp>
+
+#include <iostream>
+#include <string>
+
+namespace {
+   using namespace eosio;
+   using namespace eosio::watcher;
+
+   uint32_t failures = 0;
+
+   template<typename T>
+   void check( const char* what, const T& msg ) {
+      const std::string ours = to_json( msg );
+      const std::string theirs = fc::json::to_string( fc::variant(msg) );
+      if( ours == theirs ) return;
+      ++failures;
+      size_t at = 0;
+      while( at < ours.size() && at < theirs.size() && ours[at] == theirs[at] ) ++at;
+      const size_t from = at > 40 ? at - 40 : 0;
+      std::cerr << what << " differs at offset " << at << "\n"
+                << "  json_writer: ..." << ours.substr( from, 80 ) << "\n"
+                << "  fc::json:    ..." << theirs.substr( from, 80 ) << "\n";
+   }
+
+   chain::checksum256_type id_of( uint8_t seed ) {
+      chain::checksum256_type id;
+      for( size_t i = 0; i < id.data_size(); ++i ) id.data()[i] = char( seed + i * 7 );
+      return id;
+   }
+
+   /// Header values at the edges: the largest block_num, seqs either side of the quoting limit, times with milliseconds
+   template<typename T>
+   void fill_header( T& m, uint32_t msg_type, uint64_t seq, int64_t us ) {
+      m.block_num = 4294967295u;
+      m.block_id = id_of( 1 );
+      m.previous = id_of( 2 );
+      m.timestamp = fc::time_point( fc::microseconds(us) );
+      m.msg_type = msg_type;
+      m.seq = seq;
+   }
+
+   /// action_data with every variant type, strings needing escapes or holding invalid UTF-8 and integers either side of
+   /// the quoting limit
+   fc::variant action_data() {
+      fc::mutable_variant_object o;
+      o( "from", "eosauthority" )
+       ( "memo", std::string("tab\there \"quoted\" back\\slash\nnew line \x01 \x1f \x7f utf8 \xc3\xa9 and a long tail to cross 16 bytes") )
+       ( "invalid_utf8", std::string("lead \xc3 only, overlong \xc0\xaf, surrogate \xed\xa0\x80, past max \xf4\x90\x80\x80, stray \x80\xbf \xe2\x82") )
+       ( "small", int64_t(-5) )
+       ( "negative", int64_t(-0x100000000ll) )
+       ( "limit", uint64_t(0xffffffffull) )
+       ( "large", uint64_t(0x100000000ull) )
+       ( "large_signed", int64_t(0x100000000ll) )
+       ( "price", 1.25 )
+       ( "flag", true )
+       ( "none", fc::variant() )
+       ( "blob", fc::blob{ std::vector<char>{ 'a', 'b', 'c', 'd' } } )
+       ( "list", fc::variants{ fc::variant(1), fc::variant("x"), fc::variant(fc::variants()) } )
+       ( "nested", fc::mutable_variant_object("empty", fc::variant_object()) );
+      return fc::variant( o );
+   }
+}
+
+int main() {
+   chain::action act;
+   act.account = N(eosio.token);
+   act.name = N(transfer);
+   act.authorization.push_back( chain::permission_level{ N(eosauthority), N(active) } );
+   act.authorization.push_back( chain::permission_level{ N(chintai.a), N(owner) } );
+
+   for( uint64_t seq : { uint64_t(0), uint64_t(0xffffffffull), uint64_t(1528977600000000ull) } ) {
+      message m;
+      fill_header( m, 0, seq, 1528977600500000ll );
+      m.lane = 1;
+      m.degraded = 2;
+      m.transactions.emplace_back();
+      m.transactions.back().tx_id = id_of( 3 );
+      action_notif decoded( act, action_data() );
+      decoded.global_sequence = 123456789012ull;
+      m.transactions.back().actions.push_back( decoded );
+      action_notif raw( act, fc::variant() );
+      raw.data = chain::bytes{ 0, 1, 2, char(0xff) };
+      raw.abi_sequence = 7;
+      m.transactions.back().actions.push_back( raw );
+      m.transactions.emplace_back();
+      m.transactions.back().tx_id = id_of( 4 );
+      check( "block message", m );
+   }
+
+   irreversible_block_message irr;
+   fill_header( irr, 1, 42, 1500 );               // 1970-01-01T00:00:00.001
+   irr.transactions = { id_of(5), id_of(6) };
+   check( "irreversible block message", irr );
+
+   table_delta_message deltas;
+   fill_header( deltas, 2, 43, 0 );
+   row_delta d;
+   d.code = N(chintaitest1);
+   d.scope = N(chintaitest1);
+   d.table = N(orders);
+   d.primary_key = 0xffffffffffffffffull;
+   d.payer = N(eosauthority);
+   d.op = "remove";
+   d.data = chain::bytes{ 'r', 'o', 'w' };
+   d.row = action_data();
+   deltas.rows.push_back( d );
+   d.op = "insert";
+   d.row = fc::variant();
+   deltas.rows.push_back( d );
+   check( "table delta message", deltas );
+
+   aggregate_message agg;
+   fill_header( agg, 3, 44, 951782400000000ll );   // 2000-02-29
+   agg.candles.push_back( candle{ N(eosio.token), N(transfer), 60, fc::time_point(fc::seconds(951782400)),
+                                  1.5, 2.25, -0.5, 1e-7, 12345678.125, 6000000000ull } );
+   check( "aggregate message", agg );
+
+   abi_message abi;
+   fill_header( abi, 4, 45, 4102444799999000ll );  // 2099-12-31T23:59:59.999
+   abi.account = N(chintaitest1);
+   abi.abi_sequence = 3;
+   abi.abi = chain::bytes{ 0x0e, 'e', 'o', 's', 'i', 'o' };
+   abi.abi_hash = fc::sha256::hash( abi.abi.data(), abi.abi.size() );
+   check( "abi message", abi );
+
+   if( failures ) {
+      std::cerr << failures << " message types render differently from fc::json\n";
+      return 1;
+   }
+   std::cout << "json_writer matches fc::json for every message type\n";
+   return 0;
+}
@@ -0,0 +1,153 @@
+/**
+ *  @file
+ *  @copyright eosauthority - free to use and modify - see LICENSE.txt
+ *
+ *  Transaction ids of a block: block_transaction_ids() against calling packed_transaction::id() for every transaction,
+ *  plus the SHA-256 kernels on their own against fc::sha256::hash(). Digests are first checked against fc for every
+ *  length from 0 to 599 bytes and ids against id() for every transaction; exits with 1 on any mismatch.
+ */
+#include <eosio/watcher_plugin/sha256_batch.hpp>
+#include <eosio/watcher_plugin/transaction_ids.hpp>
+#include <eosio/chain/block.hpp>
+
+#include <fc/crypto/sha256.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+   struct options {
+      uint32_t blocks = 200;
+      uint32_t txs = 500;
+   };
+
+   /// A block of transfer-like transactions of 150-350 packed bytes, the size of most mainnet transactions
+   eosio::chain::signed_block make_block( uint32_t txs, std::mt19937& rng ) {
+      using namespace eosio::chain;
+      signed_block block;
+      for( uint32_t i = 0; i < txs; ++i ) {
+         signed_transaction trx;
+         trx.expiration = fc::time_point_sec( 1528977600 + i );
+         trx.ref_block_num = uint16_t( rng() );
+         trx.ref_block_prefix = rng();
+         action act;
+         act.account = N(eosio.token);
+         act.name = N(transfer);
+         act.authorization.push_back( permission_level{ N(eosauthority), N(active) } );
+         act.data.resize( 40 + rng() % 200 );
+         for( auto& c : act.data ) c = char( rng() );
+         trx.actions.push_back( act );
+         block.transactions.emplace_back( packed_transaction(trx) );
+      }
+      return block;
+   }
+
+   template<typename F>
+   double ns_per_call( uint64_t calls, F&& f ) {
+      const auto start = std::chrono::steady_clock::now();
+      f();
+      return std::chrono::duration<double, std::nano>( std::chrono::steady_clock::now() - start ).count() / calls;
+   }
+}
+
+int main( int argc, char** argv ) {
+   using namespace eosio;
+   options opt;
+   try {
+      for( int i = 1; i + 1 < argc; i += 2 ) {
+         const std::string arg = argv[i];
+         const unsigned long value = std::stoul( argv[i + 1] );
+         if( arg == "--blocks" ) opt.blocks = std::max<unsigned long>( 1, value );
+         else if( arg == "--txs" ) opt.txs = std::max<unsigned long>( 1, value );
+         else throw std::invalid_argument( "unknown option " + arg );
+      }
+      if( argc % 2 == 0 ) throw std::invalid_argument( "options take a value" );
+   } catch( const std::exception& e ) {
+      std::cerr << "watcher_sha256_bench: " << e.what() << "\n"
+                << "Usage: watcher_sha256_bench [--blocks N] [--txs N]\n";
+      return 1;
+   }
+
+   std::mt19937 rng( 7 );
+   uint64_t mismatches = 0;
+
+   // Every padding case of the kernels against fc
+   std::string buf( 600, '\0' );
+   for( auto& c : buf ) c = char( rng() );
+   for( size_t len = 0; len < buf.size(); ++len ) {
+      char digest[1][32];
+      const sha256_input in{ buf.data(), len };
+      sha256_batch( &in, 1, digest );
+      char portable[32];
+      sha256_detail::hash( &sha256_detail::compress_portable, buf.data(), len, portable );
+      const auto expected = fc::sha256::hash( buf.data(), len );
+      if( memcmp(digest[0], expected.data(), 32) != 0 || memcmp(portable, expected.data(), 32) != 0 ) {
+         if( ++mismatches <= 5 ) std::cerr << "digest of " << len << " bytes differs from fc\n";
+      }
+   }
+
+   std::vector<chain::signed_block> blocks;
+   for( uint32_t b = 0; b < opt.blocks; ++b ) blocks.push_back( make_block(opt.txs, rng) );
+   std::vector<chain::transaction_id_type> ids;
+   for( const auto& block : blocks ) {
+      block_transaction_ids( block, ids );
+      for( size_t i = 0; i < ids.size(); ++i ) {
+         if( ids[i] != block.transactions[i].trx.get<chain::packed_transaction>().id() && ++mismatches <= 5 ) {
+            std::cerr << "tx id " << i << " differs from packed_transaction::id()\n";
+         }
+      }
+   }
+
+   std::vector<sha256_input> inputs;
+   uint64_t bytes = 0;
+   for( const auto& block : blocks ) {
+      for( const auto& r : block.transactions ) {
+         const auto& packed = r.trx.get<chain::packed_transaction>().packed_trx;
+         inputs.push_back( sha256_input{ packed.data(), packed.size() } );
+         bytes += packed.size();
+      }
+   }
+   const uint64_t total = inputs.size();
+   std::vector<std::array<char, 32>> digests( total );
+   uint64_t sink = 0;
+
+   const double per_id = ns_per_call( total, [&]() {
+      for( const auto& block : blocks ) {
+         for( const auto& r : block.transactions ) sink += r.trx.get<chain::packed_transaction>().id().data()[0];
+      }
+   } );
+   const double per_block_ids = ns_per_call( total, [&]() {
+      for( const auto& block : blocks ) {
+         block_transaction_ids( block, ids );
+         sink += ids[0].data()[0];
+      }
+   } );
+   const double fc_hash = ns_per_call( total, [&]() {
+      for( const auto& in : inputs ) sink += fc::sha256::hash( in.data, in.size ).data()[0];
+   } );
+   const double batch = ns_per_call( total, [&]() {
+      sha256_batch( inputs.data(), total, reinterpret_cast<char(*)[32]>(digests.data()) );
+      sink += digests[0][0];
+   } );
+   const double portable = ns_per_call( total, [&]() {
+      for( size_t i = 0; i < total; ++i ) {
+         sha256_detail::hash( &sha256_detail::compress_portable, inputs[i].data, inputs[i].size, digests[i].data() );
+      }
+      sink += digests[0][0];
+   } );
+
+   printf( "%llu transactions of %.0f bytes on average, SHA extensions %s\n",
+           (unsigned long long)total, double(bytes) / total, sha256_accelerated() ? "used" : "not available" );
+   printf( "per tx: packed_transaction::id() %.0f ns, block_transaction_ids %.0f ns (%.1fx)\n",
+           per_id, per_block_ids, per_id / per_block_ids );
+   printf( "hash only: fc::sha256 %.0f ns, sha256_batch %.0f ns, portable kernel %.0f ns\n", fc_hash, batch, portable );
+   if( mismatches ) {
+      printf( "%llu digests or ids differ\n", (unsigned long long)mismatches );
+      return 1;
+   }
+   return sink == 1;
+}
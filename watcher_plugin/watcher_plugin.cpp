@@ -3,26 +3,62 @@
 *  @copyright eosauthority - free to use and modify - see LICENSE.txt
 */
 #include <eosio/watcher_plugin/watcher_plugin.hpp>
+#include <eosio/watcher_plugin/name_trie.hpp>
+#include <eosio/watcher_plugin/aggregator.hpp>
+#include <eosio/watcher_plugin/recent_index.hpp>
+#include <eosio/watcher_plugin/shm_ring.hpp>
+#include <eosio/watcher_plugin/file_sink.hpp>
+#include <eosio/watcher_plugin/zmq_endpoint.hpp>
+#include <eosio/watcher_plugin/projection.hpp>
+#include <eosio/watcher_plugin/output_encoding.hpp>
+#include <eosio/watcher_plugin/json_writer.hpp>
+#include <eosio/watcher_plugin/messages.hpp>
+#include <eosio/watcher_plugin/transaction_ids.hpp>
+#include <eosio/watcher_plugin/wire_format.hpp>
 #include <eosio/chain/controller.hpp>
 #include <eosio/chain/trace.hpp>
 #include <eosio/chain_plugin/chain_plugin.hpp>
 #include <eosio/chain/block_state.hpp>
+#include <eosio/chain/contract_table_objects.hpp>
+#include <eosio/chain/account_object.hpp>
+#include <eosio/chain/contract_types.hpp>
 
 #include <fc/io/json.hpp>
+#include <fc/variant_object.hpp>
 #include <fc/network/url.hpp>
+#include <fc/crypto/city.hpp>
 
 #include <boost/signals2/connection.hpp>
 #include <boost/algorithm/string.hpp>
 
+#include <algorithm>
+#include <atomic>
+#include <future>
+#include <thread>
+#include <tuple>
 #include <unordered_map>
+#include <unordered_set>
 #include <zmq.hpp>
 #include <string>
 
 namespace {
   const char* SENDER_BIND = "zmq-sender-bind";
   const char* SENDER_BIND_DEFAULT = "tcp://127.0.0.1:5556";
+  const char* FANOUT_BIND = "zmq-fanout-bind";
+  const char* PUB_BIND = "zmq-pub-bind";
+  const char* QUERY_BIND = "watch-query-bind";
+  const char* SHM_RING = "watch-shm-ring";
+  const char* FILE_SINK_DIR = "watch-file-sink-dir";
   const uint32_t MSG_TYPE_BLOCK = 0;
   const uint32_t MSG_TYPE_IRREVERSIBLE_BLOCK = 1;
+  const uint32_t MSG_TYPE_TABLE_DELTAS = 2;
+  const uint32_t MSG_TYPE_AGGREGATE = 3;
+  const uint32_t MSG_TYPE_ABI = 4;
+  // Degradation tiers, each implying the ones before it
+  const uint32_t DEGRADE_NONE = 0;
+  const uint32_t DEGRADE_RAW_DATA = 1;  // packed action data and ABI sequence instead of decoded action_data
+  const uint32_t DEGRADE_LEAN = 2;      // no authorization vectors
+  const uint32_t DEGRADE_IDS_ONLY = 3;  // block and tx ids only, consumers refetch the actions
 }
 
 namespace eosio {
@@ -33,41 +69,26 @@ namespace eosio {
 
    class watcher_plugin_impl {
    public:
-      typedef std::unordered_map<transaction_id_type, std::vector< action > > action_queue_t;
+      struct queued_tx {
+         uint64_t              fingerprint = 0; // of the matched actions, see fingerprint_of
+         std::vector< action > actions;
+         std::vector<uint64_t> global_sequences; // receipt global_sequence of each action
+         std::vector<uint64_t> abi_sequences;    // ABI sequence of each action's account when the action was applied
+      };
+      typedef std::unordered_map<transaction_id_type, queued_tx> action_queue_t;
 
       static const int64_t          default_age_limit = 60;
       static const fc::microseconds http_timeout;
       static const fc::microseconds max_deserialization_time;
 
-      struct action_notif {
-         action_notif(const action& act, const variant& action_data)
-         : account(act.account), name(act.name), authorization(act.authorization),
-         action_data(action_data) {}
-
-         account_name             account;
-         action_name              name;
-         vector<permission_level> authorization;
-         fc::variant              action_data;
-      };
-
-      struct transaction {
-        transaction_id_type tx_id;
-        std::vector<action_notif> actions;
-      };
-
-      struct irreversible_block_message {
-        uint32_t block_num;
-        fc::time_point timestamp;
-        uint32_t msg_type;
-        std::vector<transaction_id_type> transactions;
-      };
-
-      struct  message {
-        uint32_t block_num;
-        fc::time_point timestamp;
-        uint32_t msg_type;
-        std::vector<transaction> transactions;
-      };
+      typedef watcher::action_notif               action_notif;
+      typedef watcher::transaction                transaction;
+      typedef watcher::irreversible_block_message irreversible_block_message;
+      typedef watcher::message                    message;
+      typedef watcher::row_delta                  row_delta;
+      typedef watcher::table_delta_message        table_delta_message;
+      typedef watcher::abi_message                abi_message;
+      typedef watcher::aggregate_message          aggregate_message;
 
       struct filter_entry {
          name receiver;
@@ -83,21 +104,77 @@ namespace eosio {
       };
 
       zmq::context_t context;
-      zmq::socket_t sender_socket;
+      std::vector<std::unique_ptr<zmq_endpoint>> endpoints;
+      std::unique_ptr<shm_ring_writer> shm_ring;
+      std::atomic<uint64_t> shm_dropped{0}; // frames larger than half the ring
+      std::unique_ptr<file_sink> file_out;
+      zmq::socket_t pub_socket;
+      bool pub_enabled = false;
+      zmq::socket_t query_socket;
+      bool query_enabled = false;
+      std::atomic<bool> query_done{false};
+      std::thread query_thread;
+      recent_action_index recent_actions;
+      tx_finality_index tx_finality;
       chain_plugin* chain_plug = nullptr;
       fc::optional<boost::signals2::scoped_connection> accepted_block_conn;
       fc::optional<boost::signals2::scoped_connection> applied_tx_conn;
       fc::optional<boost::signals2::scoped_connection> irreversible_block_conn;
       std::set<watcher_plugin_impl::filter_entry>      filter_on;
+      std::unordered_set<uint64_t>                     watched_accounts; // account-wide entries of filter_on, by name value
+      name_pattern_set                                 watched_patterns; // prefix* and *suffix entries of --watch
       int64_t                                          age_limit = default_age_limit;
       action_queue_t                                   action_queue;
+      std::string                                      fingerprint_buf; // scratch for fingerprint_of
+      // seq of the next message; starting from the startup time keeps it increasing across restarts
+      uint64_t                                         next_seq = fc::time_point::now().time_since_epoch().count();
+      bool                                             table_deltas = false;
+      bool                                             table_deltas_decode = true;
+      window_aggregator                                aggregator;
+      bool                                             aggregate_only = false;
+      std::unordered_map<uint64_t, uint32_t>           action_lanes; // action name value to priority lane, 0 first
+      uint32_t                                         default_lane = 0; // lane of everything not listed, always the last
+      // (account, action) to the action_data fields to send; account 0 applies to the action of every account
+      std::map<std::pair<uint64_t, uint64_t>, std::set<std::string>> projections;
+      bool                                             raw_data = false; // send packed data and ABI sequence, leave decoding to consumers
+      struct pending_abi_change {
+        uint32_t                  block_num = 0; // pending block the tx was last applied to
+        std::vector<account_name> accounts;      // watched accounts it calls setabi for
+        std::vector<uint64_t>     abi_sequences; // sequence each setabi leads to, with the account a key of refreshing_abis
+        std::vector<bytes>        abis;          // the ABI each setabi sets, published with the block
+      };
+      std::unordered_map<transaction_id_type, pending_abi_change> abi_changes;
+      std::mutex                                       abi_messages_mtx;
+      std::unordered_map<uint64_t, std::string>        abi_messages; // last published abi_message JSON per account, for the query thread
+      std::vector<double>                              degrade_thresholds; // queue fill ratio entering each tier above DEGRADE_NONE
+      uint32_t                                         degrade_tier = DEGRADE_NONE;
+      output_encoding::name_cache                      log_names; // main thread only
+      std::vector<transaction_id_type>                 block_tx_ids; // scratch for the block being handled
 
 
       watcher_plugin_impl():
         context(1),
-        sender_socket(context, ZMQ_PUSH)
+        pub_socket(context, ZMQ_PUB),
+        query_socket(context, ZMQ_REP)
       {}
 
+      bool is_watched( const account_name& n ) const {
+        return watched_accounts.count(n.value) != 0 || (!watched_patterns.empty() && watched_patterns.match(n.value));
+      }
+
+      // True if any permission_level of the action is held by a watched account, not only authorization[0]
+      bool authorized_by_watched( const action& act ) const {
+        for (const auto& auth : act.authorization) {
+          if (is_watched(auth.actor)) return true;
+        }
+        return false;
+      }
+
+      // Actions may legitimately carry no authorization (e.g. onblock), so never index authorization[0] blindly
+      static account_name first_authorizer( const action& act ) {
+        return act.authorization.empty() ? account_name() : act.authorization[0].actor;
+      }
+
       bool filter( const action_trace& act, const transaction_id_type& tx_id) {  // Filter on any actions from Chintai and any actions going to Chintai
         if (
             act.act.name == "extensions" ||
@@ -122,10 +199,7 @@ namespace eosio {
             act.act.name == "liveundel"
             )
         {
-          if (
-            filter_on.find({ act.act.authorization[0].actor, 0 }) != filter_on.end() ||
-            filter_on.find({ act.receipt.receiver, 0 }) != filter_on.end()
-          ) {
+          if (is_watched(act.receipt.receiver) || authorized_by_watched(act.act)) {
             // Ignore invalid calls of chinundel to eosio when we accidentally broadcasted the actions to the wrong account
             if (act.act.name == "chinundel" && act.receipt.receiver == "eosio") {
               ilog("[filter] WARNING: chinundel incorrectly called on EOSIO, ignoring action and moving on. TXID: ${txid}", ("txid",tx_id));
@@ -141,32 +215,271 @@ namespace eosio {
         }
       }
 
+      typedef std::shared_ptr<const abi_serializer> abi_serializer_ptr;
+
+      struct cached_abi {
+         bool               loaded = false;
+         uint64_t           abi_sequence = 0;
+         abi_serializer_ptr serializer; // null if the account has no usable ABI
+      };
+      std::unordered_map<uint64_t, cached_abi> abi_cache; // by account
+      // Serializers being built off the signal thread after a setabi, by (account, abi_sequence the setabi leads to)
+      std::map<std::pair<uint64_t, uint64_t>, std::shared_future<abi_serializer_ptr>> refreshing_abis;
+      std::vector<std::shared_future<abi_serializer_ptr>> abandoned_abis; // of dropped setabi txs, still being built
+      /// Builds a serializer for the account's ABI as the chain db has it
+      abi_serializer_ptr load_serializer(const account_name& account) {
+         const auto* a = chain_plug->chain().db().find<account_object, by_name>(account);
+         if (a == nullptr || a->abi.size() == 0) return abi_serializer_ptr();
+         bytes raw(a->abi.data(), a->abi.data() + a->abi.size());
+         abi_def abi;
+         if (!abi_serializer::to_abi(raw, abi)) return abi_serializer_ptr();
+         return std::make_shared<const abi_serializer>(abi, max_deserialization_time);
+      }
+
+      /// Serializer for the account's current ABI, only rebuilt when its abi_sequence moves
+      abi_serializer_ptr get_serializer(const account_name& account) {
+         const auto seq = abi_sequence_of(account);
+         auto& entry = abi_cache[account.value];
+         if (entry.loaded && entry.abi_sequence == seq) return entry.serializer;
+         auto refreshing = refreshing_abis.find(std::make_pair(account.value, seq));
+         if (refreshing != refreshing_abis.end()) {
+            // Already being built by the worker, waiting is never slower than starting over
+            entry.serializer = refreshing->second.get();
+            refreshing_abis.erase(refreshing);
+         } else {
+            entry.serializer = load_serializer(account);
+         }
+         entry.abi_sequence = seq;
+         entry.loaded = true;
+         return entry.serializer;
+      }
+
+      /// Starts building the serializer for an ABI set by a pending setabi at @ref abi_sequence, so the next block
+      /// doesn't parse it inline
+      void refresh_abi(const account_name& account, uint64_t abi_sequence, bytes raw) {
+         const auto key = std::make_pair(account.value, abi_sequence);
+         if (refreshing_abis.count(key)) return;
+         refreshing_abis[key] = std::async(std::launch::async, [this, account, raw = std::move(raw)]() -> abi_serializer_ptr {
+            try {
+               abi_def abi;
+               if (!abi_serializer::to_abi(raw, abi)) return abi_serializer_ptr();
+               return std::make_shared<const abi_serializer>(abi, max_deserialization_time);
+            } catch (const fc::exception& e) {
+               wlog("[refresh_abi] Unable to build serializer for ${a}: ${e}", ("a", account)("e", e.to_string()));
+               return abi_serializer_ptr();
+            }
+         }).share();
+      }
+
+      /// Drops the serializers a setabi tx that won't make it into a block was building, except those @ref kept builds too
+      void abandon_refreshes(const pending_abi_change& dropped, const pending_abi_change* kept = nullptr) {
+         for (size_t i = 0; i < dropped.accounts.size(); ++i) {
+            const auto key = std::make_pair(dropped.accounts[i].value, dropped.abi_sequences[i]);
+            if (kept) {
+               bool same = false;
+               for (size_t k = 0; k < kept->accounts.size() && !same; ++k) {
+                  same = kept->accounts[k] == dropped.accounts[i] && kept->abi_sequences[k] == key.second;
+               }
+               if (same) continue;
+            }
+            auto itr = refreshing_abis.find(key);
+            if (itr == refreshing_abis.end()) continue;
+            // The last reference to a std::async future waits for the task, so one still running is reaped later
+            if (itr->second.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+               abandoned_abis.push_back(std::move(itr->second));
+            }
+            refreshing_abis.erase(itr);
+         }
+      }
+
+      void drop_abi_change(const transaction_id_type& tx_id) {
+         auto itr = abi_changes.find(tx_id);
+         if (itr == abi_changes.end()) return;
+         abandon_refreshes(itr->second);
+         abi_changes.erase(itr);
+      }
+
+      /// Publishes finished background serializers to the cache between blocks; drops those of abandoned setabi txs
+      void adopt_refreshed_abis() {
+         abandoned_abis.erase(std::remove_if(abandoned_abis.begin(), abandoned_abis.end(), [](const std::shared_future<abi_serializer_ptr>& f) {
+            return f.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+         }), abandoned_abis.end());
+         for (auto itr = refreshing_abis.begin(); itr != refreshing_abis.end(); ) {
+            if (itr->second.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+               ++itr;
+               continue;
+            }
+            const account_name account(itr->first.first);
+            const auto seq = abi_sequence_of(account);
+            if (seq == itr->first.second) {
+               auto& entry = abi_cache[account.value];
+               entry.serializer = itr->second.get();
+               entry.abi_sequence = seq;
+               entry.loaded = true;
+               itr = refreshing_abis.erase(itr);
+            } else if (seq > itr->first.second) {
+               itr = refreshing_abis.erase(itr);
+            } else {
+               ++itr;
+            }
+         }
+      }
+
+      struct compiled_projection {
+         uint64_t                        abi_sequence = 0;
+         abi_serializer_ptr              abi;
+         projection_plan                 plan;
+      };
+      std::map<std::pair<uint64_t, uint64_t>, compiled_projection> compiled_projections; // by (account, action)
+
+      /// Decode plan for the projected fields of an action, recompiled when the account's ABI changed
+      const compiled_projection& projection_for(const account_name& account, const action_name& act_name, const std::set<std::string>& fields) {
+         const auto seq = abi_sequence_of(account);
+         auto& cp = compiled_projections[std::make_pair(account.value, act_name.value)];
+         if (!cp.abi || cp.abi_sequence != seq) {
+            auto serializer = get_serializer(account);
+            FC_ASSERT(serializer && serializer->get_action_type(act_name) != type_name(),
+            "Unable to get abi for account: ${acc}, action: ${a} Not sending notification.",
+            ("acc", account)("a", act_name));
+            cp.abi = serializer;
+            cp.plan = projection_plan(*cp.abi, cp.abi->get_action_type(act_name), fields);
+            cp.abi_sequence = seq;
+            if (!cp.plan.missing_fields().empty()) {
+              wlog("[projection_for] ${acc}:${a} has no field ${f} at ABI sequence ${s}, --watch-project leaves it out",
+                   ("acc", account)("a", act_name)("f", boost::algorithm::join(cp.plan.missing_fields(), ","))("s", seq));
+            }
+         }
+         return cp;
+      }
+
+      fc::variant project_action_data(const action& act, const std::set<std::string>& fields) {
+         const auto& cp = projection_for(act.account, act.name, fields);
+         return cp.plan.decode(*cp.abi, act.data, max_deserialization_time);
+      }
+
+      /// Fields to send of an action, those given for its account before those given for every account; null for all
+      const std::set<std::string>* projection_of(const action& act) const {
+         if (projections.empty()) return nullptr;
+         auto itr = projections.find(std::make_pair(act.account.value, act.name.value));
+         if (itr == projections.end()) itr = projections.find(std::make_pair(uint64_t(0), act.name.value));
+         return itr == projections.end() ? nullptr : &itr->second;
+      }
+
+      fc::variant decode_action_data(const action& act) {
+         if (const auto* fields = projection_of(act)) return project_action_data(act, *fields);
+         return deserialize_action_data(act);
+      }
+
       fc::variant deserialize_action_data(action act) {
-         auto& chain = chain_plug->chain();
-         auto serializer = chain.get_abi_serializer(act.account, max_deserialization_time);
-         FC_ASSERT(serializer.valid() &&
+         auto serializer = get_serializer(act.account);
+         FC_ASSERT(serializer &&
          serializer->get_action_type(act.name) != action_name(),
          "Unable to get abi for account: ${acc}, action: ${a} Not sending notification.",
          ("acc", act.account)("a", act.name));
-         return serializer->binary_to_variant(act.name.to_string(), act.data,
+         return serializer->binary_to_variant(output_encoding::name_string(act.name.value), act.data,
          max_deserialization_time);
       }
 
-      void on_action_trace( const action_trace& act, const transaction_id_type& tx_id ) {
-        if(filter(act, tx_id)) {
-          action_queue[tx_id].push_back(act.act);
-          std::string data = "";
-          if (!act.act.data.empty() && act.act.name != N(processpool)) {
-            data = fc::json::to_string(deserialize_action_data(act.act));
+      /// action_data for log lines; nothing is decoded on the signal thread in raw mode or while degraded
+      std::string log_action_data(const action& act) {
+        if (raw_data || degrade_tier != DEGRADE_NONE || act.data.empty() || act.name == N(processpool)) return "";
+        return fc::json::to_string(deserialize_action_data(act));
+      }
+
+      static std::string log_tx_id( const transaction_id_type& tx_id ) {
+        return output_encoding::hex_string(tx_id.data(), tx_id.data_size());
+      }
+
+      static bool is_setabi( const action_trace& act ) {
+        return act.act.name == N(setabi) && act.act.account == config::system_account_name &&
+               act.receipt.receiver == config::system_account_name;
+      }
+
+      /// Matched actions and setabi calls of a trace, depth first in execution order; has no effect on plugin state
+      void collect_trace( const action_trace& act, const transaction_id_type& tx_id,
+                          std::vector<const action_trace*>& matched, std::vector<const action_trace*>& abi_sets ) {
+        if (is_setabi(act)) abi_sets.push_back(&act);
+        if (filter(act, tx_id)) matched.push_back(&act);
+        for(const auto& iline : act.inline_traces) {
+          collect_trace(iline, tx_id, matched, abi_sets);
+        }
+      }
+
+      /// Digest of what on_applied_tx takes from a trace, so a re-application that changes nothing can be recognized
+      uint64_t fingerprint_of( const std::vector<const action_trace*>& matched, const std::vector<const action_trace*>& abi_sets ) {
+        fingerprint_buf.clear();
+        auto append = [this](const void* p, size_t n) { fingerprint_buf.append(static_cast<const char*>(p), n); };
+        for (const auto* list : { &matched, &abi_sets }) {
+          for (const auto* at : *list) {
+            const auto& a = at->act;
+            append(&at->receipt.receiver.value, sizeof(uint64_t));
+            append(&a.account.value, sizeof(uint64_t));
+            append(&a.name.value, sizeof(uint64_t));
+            for (const auto& auth : a.authorization) {
+              append(&auth.actor.value, sizeof(uint64_t));
+              append(&auth.permission.value, sizeof(uint64_t));
+            }
+            const uint64_t size = a.data.size();
+            append(&size, sizeof(size));
+            append(a.data.data(), a.data.size());
           }
-          ilog("[on_action_trace] [${txid}] Added trace to queue: ${action} | To: ${to} | From: ${from} | Data: ${data}", ("txid",tx_id.str().c_str())("action",act.act.name.to_string().c_str())("to",act.act.account.to_string().c_str())("from",act.act.authorization[0].actor.to_string().c_str())("data",data.c_str()));
+          fingerprint_buf += '|';
         }
+        return fc::city_hash64(fingerprint_buf.data(), fingerprint_buf.size());
+      }
 
-        for(const auto& iline : act.inline_traces) {
-          on_action_trace(iline, tx_id);
+      /// Account a setabi action sets the ABI of, read without unpacking the ABI itself
+      static account_name setabi_account( const action& act ) {
+        fc::datastream<const char*> ds(act.data.data(), act.data.size());
+        account_name account;
+        fc::raw::unpack(ds, account);
+        return account;
+      }
+
+      /// ABI sequence @ref account had right after the action at @ref global_sequence was applied: the tx has been
+      /// applied in full by now, so setabi calls on the account it made later are taken back off the current sequence
+      uint64_t abi_sequence_at( const account_name& account, uint64_t global_sequence, const std::vector<const action_trace*>& abi_sets ) {
+        uint64_t seq = abi_sequence_of(account);
+        for (const auto* set : abi_sets) {
+          if (set->receipt.global_sequence > global_sequence && setabi_account(set->act) == account) --seq;
+        }
+        return seq;
+      }
+
+      /// True if a setabi of @ref change no longer leads to the ABI sequence recorded for it
+      bool abi_sequences_moved( const pending_abi_change& change, const std::vector<const action_trace*>& abi_sets ) {
+        size_t i = 0;
+        for (const auto* set : abi_sets) {
+          const auto account = setabi_account(set->act);
+          if (!is_watched(account)) continue;
+          if (i >= change.abi_sequences.size() ||
+              change.abi_sequences[i++] != abi_sequence_at(account, set->receipt.global_sequence, abi_sets)) return true;
+        }
+        return false;
+      }
+
+      void on_abi_set( const action_trace& act, const transaction_id_type& tx_id, const std::vector<const action_trace*>& abi_sets ) {
+        auto set = act.act.data_as<setabi>();
+        if (is_watched(set.account)) {
+          const auto seq = abi_sequence_at(set.account, act.receipt.global_sequence, abi_sets);
+          auto& change = abi_changes[tx_id];
+          change.block_num = chain_plug->chain().head_block_num() + 1;
+          change.accounts.push_back(set.account);
+          change.abi_sequences.push_back(seq);
+          change.abis.push_back(set.abi);
+          refresh_abi(set.account, seq, std::move(set.abi));
         }
       }
 
+      void on_action_trace( const action_trace& act, const transaction_id_type& tx_id, const std::vector<const action_trace*>& abi_sets ) {
+        auto& queued = action_queue[tx_id];
+        queued.actions.push_back(act.act);
+        queued.global_sequences.push_back(act.receipt.global_sequence);
+        queued.abi_sequences.push_back(abi_sequence_at(act.act.account, act.receipt.global_sequence, abi_sets));
+        std::string data = log_action_data(act.act);
+        ilog("[on_action_trace] [${txid}] Added trace to queue: ${action} | To: ${to} | From: ${from} | Data: ${data}", ("txid",log_tx_id(tx_id))("action",log_names(act.act.name.value))("to",log_names(act.act.account.value))("from",log_names(first_authorizer(act.act).value))("data",data));
+      }
+
       void on_applied_tx(const transaction_trace_ptr& trace) {
         if (trace->receipt) {
           // Ignore failed deferred tx that may still send an applied_transaction signal
@@ -176,75 +489,386 @@ namespace eosio {
 
           // If we later find that a transaction was failed before it's included in a block, remove its actions from the action queue
           if (trace->failed_dtrx_trace) {
+            drop_abi_change(trace->failed_dtrx_trace->id);
             if (action_queue.count(trace->failed_dtrx_trace->id)) {
               action_queue.erase(action_queue.find(trace->failed_dtrx_trace->id));
               return;
             }
           }
 
-          if (action_queue.count(trace->id)) {
+          std::vector<const action_trace*> matched, abi_sets;
+          for (const auto& at : trace->action_traces) {
+            collect_trace(at, trace->id, matched, abi_sets);
+          }
+          const uint64_t fingerprint = fingerprint_of(matched, abi_sets);
+          auto queued = action_queue.find(trace->id);
+          if (queued != action_queue.end() && queued->second.fingerprint == fingerprint) {
+            // Unapplied transactions are re-applied at the start of every pending block; the queue entry and any ABI
+            // change recorded the first time still hold, only global and ABI sequences follow the order of application
+            auto& sequences = queued->second.global_sequences;
+            auto& abi_seqs = queued->second.abi_sequences;
+            for (size_t i = 0; i < matched.size(); ++i) {
+              sequences[i] = matched[i]->receipt.global_sequence;
+              abi_seqs[i] = abi_sequence_at(matched[i]->act.account, sequences[i], abi_sets);
+            }
+            auto changed = abi_changes.find(trace->id);
+            if (changed != abi_changes.end()) {
+              changed->second.block_num = chain_plug->chain().head_block_num() + 1;
+              if (abi_sequences_moved(changed->second, abi_sets)) {
+                // A setabi of another tx went in first, serializers are rebuilt for the sequences these now lead to
+                pending_abi_change previous_change = std::move(changed->second);
+                abi_changes.erase(changed);
+                for (const auto* at : abi_sets) {
+                  on_abi_set(*at, trace->id, abi_sets);
+                }
+                abandon_refreshes(previous_change, &abi_changes[trace->id]);
+              }
+            }
+            return;
+          }
+
+          // Applied differently than before, e.g. on another fork: serializers for ABIs it no longer sets are dropped below
+          pending_abi_change previous_change;
+          auto changed = abi_changes.find(trace->id);
+          if (changed != abi_changes.end()) {
+            previous_change = std::move(changed->second);
+            abi_changes.erase(changed);
+          }
+
+          if (queued != action_queue.end()) {
             ilog("[on_applied_tx] FORK WARNING: tx_id ${i} already exists -- removing existing entry before processing new actions", ("i", trace->id));
             ilog("[on_applied_tx] -------------------------------------------------------------------------------------------------------------------------------------------");
             ilog("[on_applied_tx] Previously captured tx action contents (to be removed):");
-            auto range = action_queue.find(trace->id);
-            for (int i = 0; i < range->second.size(); ++i) {
-              std::string data = "";
-              if (!range->second.at(i).data.empty() && range->second.at(i).name != N(processpool)) {
-                data = fc::json::to_string(deserialize_action_data(range->second.at(i)));
-              }
-              ilog("[on_applied_tx] [${txid}] Action: ${action} | To: ${to} | From: ${from} | Data: ${data}", ("txid",trace->id.str().c_str())("action",range->second.at(i).name.to_string().c_str())("to",range->second.at(i).account.to_string().c_str())("from",range->second.at(i).authorization[0].actor.to_string().c_str())("data",data.c_str()));
+            const auto& previous = queued->second.actions;
+            for (int i = 0; i < previous.size(); ++i) {
+              std::string data = log_action_data(previous.at(i));
+              ilog("[on_applied_tx] [${txid}] Action: ${action} | To: ${to} | From: ${from} | Data: ${data}", ("txid",log_tx_id(trace->id))("action",log_names(previous.at(i).name.value))("to",log_names(previous.at(i).account.value))("from",log_names(first_authorizer(previous.at(i)).value))("data",data));
             }
             ilog("[on_applied_tx] ==================================================================");
             ilog("[on_applied_tx] ==================================================================");
             ilog("[on_applied_tx] New trace contents to be processed for this tx:");
             for (auto at : trace->action_traces) {
-              std::string data = "";
-              if (!at.act.data.empty() && at.act.name != N(processpool)) {
-                data = fc::json::to_string(deserialize_action_data(at.act));
-              }
-              ilog("[on_applied_tx] [${txid}] Action: ${action} | To: ${to} | From: ${from} | Data: ${data}", ("txid",trace->id.str().c_str())("action",at.act.name.to_string().c_str())("to",at.act.account.to_string().c_str())("from",at.act.authorization[0].actor.to_string().c_str())("data",data.c_str()));
+              std::string data = log_action_data(at.act);
+              ilog("[on_applied_tx] [${txid}] Action: ${action} | To: ${to} | From: ${from} | Data: ${data}", ("txid",log_tx_id(trace->id))("action",log_names(at.act.name.value))("to",log_names(at.act.account.value))("from",log_names(first_authorizer(at.act).value))("data",data));
             }
             ilog("[on_applied_tx] -------------------------------------------------------------------------------------------------------------------------------------------");
-            action_queue.erase(action_queue.find(trace->id));
+            action_queue.erase(queued);
           }
 
-          for (auto& at : trace->action_traces) {
-             on_action_trace(at, trace->id);
+          for (const auto* at : abi_sets) {
+            on_abi_set(*at, trace->id, abi_sets);
+          }
+          if (!previous_change.accounts.empty()) {
+            changed = abi_changes.find(trace->id);
+            abandon_refreshes(previous_change, changed == abi_changes.end() ? nullptr : &changed->second);
+          }
+          for (const auto* at : matched) {
+            on_action_trace(*at, trace->id, abi_sets);
           }
+          if (!matched.empty()) {
+            action_queue[trace->id].fingerprint = fingerprint;
+          }
+        }
+      }
+
+      uint64_t abi_sequence_of(const account_name& account) {
+        const auto* seq = chain_plug->chain().db().find<account_sequence_object, by_name>(account);
+        return seq ? seq->abi_sequence : 0;
+      }
+
+      /// Picks the degradation tier from the fill of the fullest endpoint lane or file sink queue
+      uint32_t current_degrade_tier() const {
+        if (degrade_thresholds.empty()) return DEGRADE_NONE;
+        double fill = 0;
+        for (const auto& ep : endpoints) {
+          fill = std::max(fill, ep->fill());
         }
+        if (file_out) fill = std::max(fill, double(file_out->depth()) / file_out->capacity());
+        uint32_t tier = DEGRADE_NONE;
+        while (tier < degrade_thresholds.size() && fill >= degrade_thresholds[tier]) ++tier;
+        return tier;
       }
 
-      void build_message(const transaction_id_type& tx_id, transaction& tx) {
+      /// Feeds the aggregator the complete action_data, also when the message carries packed, degraded or projected data
+      void aggregate_action(const action& act, const action_notif& notif, bool complete, const fc::time_point& btime) {
+        if (aggregator.empty() || !aggregator.tracks(act.account, act.name)) return;
+        if (complete) {
+          aggregator.add(act.account, act.name, notif.action_data, btime);
+          return;
+        }
+        try {
+          aggregator.add(act.account, act.name, deserialize_action_data(act), btime);
+        } catch (const fc::exception& e) {
+          wlog("[aggregate_action] Unable to decode ${acc}:${a} for aggregation: ${e}", ("acc", act.account)("a", act.name)("e", e.to_string()));
+        }
+      }
+
+      void build_message(const transaction_id_type& tx_id, transaction& tx, const fc::time_point& btime, uint32_t tier = DEGRADE_NONE) {
          // ilog("inside build_message - tx_id: ${u}", ("u",tx_id));
          auto range = action_queue.find(tx_id);
          if(range == action_queue.end()) return;
+         if(tier >= DEGRADE_IDS_ONLY) return;
 
-         for(int i = 0; i < range->second.size(); ++i ) {
+         for(int i = 0; i < range->second.actions.size(); ++i ) {
+            if(tier >= DEGRADE_RAW_DATA || raw_data) {
+              action_notif notif( range->second.actions.at(i), variant() );
+              notif.data = range->second.actions.at(i).data;
+              notif.abi_sequence = range->second.abi_sequences.at(i);
+              notif.global_sequence = range->second.global_sequences.at(i);
+              if(tier >= DEGRADE_LEAN) notif.authorization.clear();
+              aggregate_action(range->second.actions.at(i), notif, false, btime);
+              tx.actions.push_back(std::move(notif));
+              continue;
+            }
             // ilog("inside build_message for loop on iterator for action_queue range");
-            // ilog("iterator range->second.at(i): ${u}", ("u",range->second.at(i).name));
-            if(!range->second.at(i).data.empty() && range->second.at(i).name != N(processpool)) {
-              auto act_data = deserialize_action_data(range->second.at(i));
-              action_notif notif( range->second.at(i), std::forward<fc::variant>(act_data) );
+            // ilog("iterator range->second.actions.at(i): ${u}", ("u",range->second.actions.at(i).name));
+            if(!range->second.actions.at(i).data.empty() && range->second.actions.at(i).name != N(processpool)) {
+              auto act_data = decode_action_data(range->second.actions.at(i));
+              action_notif notif( range->second.actions.at(i), std::forward<fc::variant>(act_data) );
+              notif.global_sequence = range->second.global_sequences.at(i);
+              aggregate_action(range->second.actions.at(i), notif, !projection_of(range->second.actions.at(i)), btime);
               tx.actions.push_back(notif);
-              // if(range->second.at(i).name == "transfer" && filter_on.find({ range->second.at(i).authorization[0].actor, 0 }) != filter_on.end() ) {
+              // if(range->second.actions.at(i).name == "transfer" && filter_on.find({ range->second.actions.at(i).authorization[0].actor, 0 }) != filter_on.end() ) {
               //   i += 2;
               // }
             } else {
               variant dummy;
-              action_notif notif( range->second.at(i), dummy);
+              action_notif notif( range->second.actions.at(i), dummy);
+              notif.global_sequence = range->second.global_sequences.at(i);
               tx.actions.push_back(notif);
             }
          }
       }
 
+      // Transports a frame is written to, combined into the mask the pipeline is instantiated for
+      static constexpr uint32_t TRANSPORT_PUSH = 1;
+      static constexpr uint32_t TRANSPORT_PUB = 2;
+      static constexpr uint32_t TRANSPORT_SHM = 4;
+      static constexpr uint32_t TRANSPORT_FILE = 8;
+      static constexpr uint32_t TRANSPORT_COMBINATIONS = 16;
+
+      template<typename T>
+      using send_fn = void (*)(watcher_plugin_impl&, const T&, size_t lane);
+
+      /// The encode and send path of each message type for the wire format and transports chosen at startup
+      typedef std::tuple<send_fn<message>, send_fn<irreversible_block_message>, send_fn<table_delta_message>,
+                         send_fn<abi_message>, send_fn<aggregate_message>> pipeline_t;
+      pipeline_t pipeline;
+
+      template<wire_format Format, uint32_t Transports, typename T>
+      static void send_via(watcher_plugin_impl& self, const T& msg, size_t lane) {
+        auto frame = std::make_shared<const string>(frame_encoder<Format>::encode(msg));
+        if (Transports & TRANSPORT_PUSH) {
+          // Every endpoint gets the full stream through its own queue, the encoded frame itself is shared
+          for (auto& ep : self.endpoints) {
+            ep->push(frame, lane);
+          }
+        }
+        if (Transports & TRANSPORT_PUB) {
+          self.publish(frame);
+        }
+        if (Transports & TRANSPORT_SHM) {
+          self.write_shm(msg, *frame);
+        }
+        if (Transports & TRANSPORT_FILE) {
+          file_sink::frame f;
+          fill_index(msg, f);
+          f.payload = *frame;
+          self.file_out->push(std::move(f));
+        }
+      }
+
+      template<wire_format Format, uint32_t Transports>
+      static pipeline_t make_pipeline() {
+        return pipeline_t(&send_via<Format, Transports, message>, &send_via<Format, Transports, irreversible_block_message>,
+                          &send_via<Format, Transports, table_delta_message>, &send_via<Format, Transports, abi_message>,
+                          &send_via<Format, Transports, aggregate_message>);
+      }
+
+      template<wire_format Format, uint32_t... Transports>
+      static pipeline_t select_pipeline(uint32_t transports, std::integer_sequence<uint32_t, Transports...>) {
+        static const pipeline_t pipelines[] = { make_pipeline<Format, Transports>()... };
+        return pipelines[transports];
+      }
+
+      /// Every format and transport combination is instantiated, this only picks one of them
+      static pipeline_t select_pipeline(wire_format format, uint32_t transports) {
+        typedef std::make_integer_sequence<uint32_t, TRANSPORT_COMBINATIONS> all_transports;
+        switch (format) {
+          case wire_format::json:   return select_pipeline<wire_format::json>(transports, all_transports());
+          case wire_format::binary: return select_pipeline<wire_format::binary>(transports, all_transports());
+          case wire_format::zlib:   return select_pipeline<wire_format::zlib>(transports, all_transports());
+        }
+        FC_THROW_EXCEPTION(fc::invalid_arg_exception, "Unknown wire format");
+      }
+
+      uint32_t active_transports() const {
+        return (endpoints.empty() ? 0 : TRANSPORT_PUSH) | (pub_enabled ? TRANSPORT_PUB : 0) |
+               (shm_ring ? TRANSPORT_SHM : 0) | (file_out ? TRANSPORT_FILE : 0);
+      }
+
+      /// A frame too large for the ring is dropped there, failing the block would fail block processing in nodeos
+      template<typename T>
+      void write_shm(const T& msg, const string& frame) {
+        try {
+          shm_ring->write(frame.data(), frame.size());
+        } catch (const std::length_error& e) {
+          ++shm_dropped;
+          wlog("[write_shm] Dropped msg_type ${t} of block ${b} from the shared memory ring, ${n} bytes: ${e}. ${d} dropped so far, raise watch-shm-ring-size",
+               ("t", msg.msg_type)("b", msg.block_num)("n", frame.size())("e", e.what())("d", shm_dropped.load()));
+        }
+      }
+
+      static void release_frame(void*, void* hint) {
+        delete static_cast<shared_frame*>(hint);
+      }
+
+      /// PUB drops frames for subscribers at their high water mark, so this never blocks
+      void publish(const shared_frame& frame) {
+        auto* hint = new shared_frame(frame);
+        zmq::message_t message(const_cast<char*>(frame->data()), frame->size(), &watcher_plugin_impl::release_frame, hint);
+        pub_socket.send(message, ZMQ_DONTWAIT);
+      }
+
       template<typename T>
-      void send_zmq_message(const  T& msg) {
-        // ilog("Sending: ${u}",("u",fc::json::to_string(msg)));
-        string zao_json = fc::json::to_string(msg);
-        zmq::message_t message(zao_json.length());
-        unsigned char* ptr = (unsigned char*) message.data();
-        memcpy(ptr, zao_json.c_str(), zao_json.length());
-        sender_socket.send(message);
+      void send_zmq_message(T& msg, size_t lane = SIZE_MAX) {
+        // ilog("Sending: ${u}",("u",to_json(msg)));
+        msg.seq = next_seq++;
+        std::get<send_fn<T>>(pipeline)(*this, msg, lane);
+      }
+
+      /// Fills the header every message starts with
+      template<typename T>
+      static void set_header(T& msg, const block_state& block, uint32_t msg_type) {
+        msg.block_num = block.block_num;
+        msg.block_id = block.id;
+        msg.previous = block.header.previous;
+        msg.timestamp = block.header.timestamp;
+        msg.msg_type = msg_type;
+      }
+
+      /// {"block_num":...,"tx_id":"...","action":{...}} as kept in the recent action index
+      template<typename Notif>
+      static std::string recent_action_json(uint32_t block_num, const transaction_id_type& tx_id, const Notif& notif) {
+        std::string out;
+        json_writer w(out);
+        out += "{\"block_num\":";
+        w.write(block_num);
+        out += ",\"tx_id\":";
+        w.write(tx_id);
+        out += ",\"action\":";
+        w.write(notif);
+        out += '}';
+        return out;
+      }
+
+      template<typename T>
+      static void fill_index(const T& msg, file_sink::frame& f) {
+        f.block_num = msg.block_num;
+        f.msg_type = msg.msg_type;
+      }
+
+      static void fill_index(const message& msg, file_sink::frame& f) {
+        f.block_num = msg.block_num;
+        f.msg_type = msg.msg_type;
+        f.tx_ids.reserve(msg.transactions.size());
+        for (const auto& tx : msg.transactions) {
+          f.tx_ids.emplace_back();
+          memcpy(f.tx_ids.back().data(), tx.tx_id.data(), f.tx_ids.back().size());
+        }
+      }
+
+      // Collects the contract rows of watched accounts touched by the block from the undo session chainbase keeps for it
+      void capture_table_deltas(const block_state_ptr& block_state, table_delta_message& msg) {
+        const auto& db = chain_plug->chain().db();
+        const auto& kv_index = db.get_index<key_value_index>();
+        const auto& table_index = db.get_index<table_id_multi_index>();
+        // Undo sessions are not kept while replaying irreversible blocks, there is nothing to diff against then
+        if (kv_index.stack().empty() || kv_index.stack().back().revision != block_state->block_num) return;
+        const auto& undo = kv_index.stack().back();
+
+        auto table_of = [&](const table_id_object::id_type& t_id) -> const table_id_object* {
+          if (auto* t = db.find<table_id_object>(t_id)) return t;
+          // Removing the last row of a table also removes the table itself
+          if (table_index.stack().empty()) return nullptr;
+          const auto& removed = table_index.stack().back().removed_values;
+          auto itr = removed.find(t_id);
+          return itr != removed.end() ? &itr->second : nullptr;
+        };
+
+        auto add_row = [&](const key_value_object& kv, const char* op) {
+          const auto* t = table_of(kv.t_id);
+          if (t == nullptr || !is_watched(t->code)) return;
+          row_delta d;
+          d.code = t->code;
+          d.scope = t->scope;
+          d.table = t->table;
+          d.primary_key = kv.primary_key;
+          d.payer = kv.payer;
+          d.op = op;
+          d.data.assign(kv.value.data(), kv.value.data() + kv.value.size());
+          if (table_deltas_decode) {
+            d.row = deserialize_table_row(get_serializer(t->code), d);
+          }
+          msg.rows.emplace_back(std::move(d));
+        };
+
+        for (const auto& id : undo.new_ids) add_row(db.get<key_value_object>(id), "insert");
+        for (const auto& old : undo.old_values) add_row(db.get<key_value_object>(old.first), "modify");
+        for (const auto& old : undo.removed_values) add_row(old.second, "remove");
+      }
+
+      fc::variant deserialize_table_row(const abi_serializer_ptr& serializer, const row_delta& d) {
+        if (!serializer) return variant();
+        auto type = serializer->get_table_type(d.table);
+        if (type.empty()) return variant();
+        try {
+          return serializer->binary_to_variant(type, d.data, max_deserialization_time);
+        } catch (const fc::exception& e) {
+          wlog("[capture_table_deltas] Unable to decode ${code}:${table} row ${pk}, sending packed row only: ${e}",
+               ("code",d.code)("table",d.table)("pk",d.primary_key)("e",e.to_string()));
+          return variant();
+        }
+      }
+
+      uint32_t lane_of(const action_name& n) const {
+        auto itr = action_lanes.find(n.value);
+        return itr == action_lanes.end() ? default_lane : itr->second;
+      }
+
+      /// Moves actions of priority lanes out of @ref msg into one message per lane, keeping block order within each lane
+      std::vector<message> split_lanes(message& msg) {
+        std::vector<message> lanes(default_lane);
+        for (auto& tx : msg.transactions) {
+          std::vector<action_notif> keep;
+          for (auto& notif : tx.actions) {
+            const auto lane = lane_of(notif.name);
+            if (lane == default_lane) {
+              keep.push_back(std::move(notif));
+              continue;
+            }
+            auto& txs = lanes[lane].transactions;
+            if (txs.empty() || txs.back().tx_id != tx.tx_id) {
+              txs.emplace_back();
+              txs.back().tx_id = tx.tx_id;
+            }
+            txs.back().actions.push_back(std::move(notif));
+          }
+          tx.actions = std::move(keep);
+        }
+        msg.transactions.erase(std::remove_if(msg.transactions.begin(), msg.transactions.end(),
+                                              [](const transaction& tx) { return tx.actions.empty(); }),
+                               msg.transactions.end());
+        for (uint32_t i = 0; i < lanes.size(); ++i) {
+          lanes[i].block_num = msg.block_num;
+          lanes[i].block_id = msg.block_id;
+          lanes[i].previous = msg.previous;
+          lanes[i].timestamp = msg.timestamp;
+          lanes[i].msg_type = msg.msg_type;
+          lanes[i].lane = i;
+        }
+        msg.lane = default_lane;
+        return lanes;
       }
 
       void on_accepted_block(const block_state_ptr& block_state) {
@@ -253,29 +877,46 @@ namespace eosio {
           message msg;
           transaction_id_type tx_id;
           uint32_t block_num = block_state->block->block_num();
+          if (!refreshing_abis.empty() || !abandoned_abis.empty()) adopt_refreshed_abis();
+          const uint32_t tier = current_degrade_tier();
+          if (tier != degrade_tier) {
+            wlog("[on_accepted_block] Send queues are at degradation tier ${t} (was ${p}) from block ${b}", ("t",tier)("p",degrade_tier)("b",block_num));
+            degrade_tier = tier;
+          }
+          msg.degraded = tier;
+          std::vector<pending_abi_change> abi_updates;
+          if (query_enabled) {
+            recent_actions.start_block(block_num);
+            tx_finality.start_block(block_num);
+          }
           //~ ilog("Block_num: ${u}", ("u",block_num));
 
           //~ Process transactions from `block_state->block->transactions` because it includes all transactions including deferred ones
-          //~ ilog("Looping over all transaction objects in block_state->block->transactions");
-          for( const auto& trx : block_state->block->transactions ) {
-            if(trx.trx.contains<transaction_id_type>()) {
-              //~ For deferred transactions the transaction id is easily accessible
-              // ilog("Running: trx.trx.get<transaction_id_type>()");
-              // ilog("===> block_state->block->transactions->trx ID: ${u}", ("u",trx.trx.get<transaction_id_type>()));
-              tx_id = trx.trx.get<transaction_id_type>();
-            } else {
-              //~ For non-deferred transactions we have to access the txid from within the packed transaction. The `trx` structure and `id()` getter method are defined in `transaction.hpp`
-              // ilog("Running: trx.trx.get<packed_transaction>().id()");
-              // ilog("===> block_state->block->transactions->trx ID: ${u}", ("u",trx.trx.get<packed_transaction>().id()));
-              tx_id = trx.trx.get<packed_transaction>().id();
+          //~ Deferred transactions carry their id, the ids of packed transactions are hashed for the whole block at once
+          block_transaction_ids(*block_state->block, block_tx_ids);
+          for( const auto& id : block_tx_ids ) {
+            tx_id = id;
+
+            if(!abi_changes.empty()) {
+              auto changed = abi_changes.find(tx_id);
+              if(changed != abi_changes.end()) {
+                abi_updates.push_back(std::move(changed->second));
+                abi_changes.erase(changed);
+              }
             }
 
             if(action_queue.count(tx_id)) {
               ilog("[on_accepted_block] block_num: ${u}", ("u",block_state->block->block_num()));
-              ilog("[on_accepted_block] Matched TX in accepted block: ${tx}", ("tx",tx_id));
+              ilog("[on_accepted_block] Matched TX in accepted block: ${tx}", ("tx",log_tx_id(tx_id)));
               transaction tx;
               tx.tx_id = tx_id;
-              build_message(tx_id, tx);
+              build_message(tx_id, tx, btime, tier);
+              if (query_enabled) {
+                for (const auto& notif : tx.actions) {
+                  recent_actions.add(block_num, tx_id, notif.account, recent_action_json(block_num, tx_id, notif));
+                }
+                tx_finality.accepted(block_num, tx_id);
+              }
               msg.transactions.push_back(tx);
               action_queue.erase(action_queue.find(tx_id));
               ilog("[on_accepted_block] Action queue size after removing item: ${i}", ("i",action_queue.size()));
@@ -285,33 +926,225 @@ namespace eosio {
           //~ ilog("Done processing block_state->block->transactions");
 
           //~ Always make sure we send a new block notification to the watcher plugin for candlestick charting timestamps
-          msg.block_num = block_num;
-          msg.timestamp = btime;
-          msg.msg_type = MSG_TYPE_BLOCK;
-          send_zmq_message<message>(msg);
+          set_header(msg, *block_state, MSG_TYPE_BLOCK);
+          // Published before the block message, so consumers hold the ABI at every abi_sequence its actions carry
+          for (const auto& change : abi_updates) {
+            for (size_t i = 0; i < change.accounts.size(); ++i) {
+              publish_abi(make_abi_message(change.accounts[i], change.abi_sequences[i], change.abis[i], *block_state));
+            }
+          }
+          // Ids only messages have no actions to split by lane, they would lose every transaction
+          if (!action_lanes.empty() && msg.degraded < DEGRADE_IDS_ONLY) {
+            for (auto& lane_msg : split_lanes(msg)) {
+              lane_msg.degraded = msg.degraded;
+              if (!lane_msg.transactions.empty()) {
+                send_zmq_message<message>(lane_msg, lane_msg.lane);
+              }
+            }
+          }
+          // Aggregate messages carry the window boundaries, so blocks without matches are only needed without them
+          if (!aggregate_only || !msg.transactions.empty()) {
+            send_zmq_message<message>(msg, default_lane);
+          }
+
+          if (!aggregator.empty()) {
+            aggregate_message agg;
+            aggregator.close_until(btime, agg.candles);
+            if (!agg.candles.empty()) {
+              set_header(agg, *block_state, MSG_TYPE_AGGREGATE);
+              send_zmq_message<aggregate_message>(agg);
+            }
+          }
+
+          if (table_deltas) {
+            table_delta_message deltas;
+            capture_table_deltas(block_state, deltas);
+            if (!deltas.rows.empty()) {
+              set_header(deltas, *block_state, MSG_TYPE_TABLE_DELTAS);
+              send_zmq_message<table_delta_message>(deltas);
+            }
+          }
         }
 
         // Clear the queue. Any actions that were not included since the last block *should* be detected again the next time on_applied_tx is called for it
         // action_queue.clear();
       }
 
+      /// The account's current ABI, as the chain db has it
+      abi_message make_abi_message(const account_name& account, const block_state& block) {
+        bytes raw;
+        if (const auto* a = chain_plug->chain().db().find<account_object, by_name>(account)) {
+          raw.assign(a->abi.data(), a->abi.data() + a->abi.size());
+        }
+        return make_abi_message(account, abi_sequence_of(account), raw, block);
+      }
+
+      /// The ABI a setabi of @ref block set, which later setabi calls may have replaced in the chain db already
+      abi_message make_abi_message(const account_name& account, uint64_t abi_sequence, const bytes& raw, const block_state& block) {
+        abi_message m;
+        set_header(m, block, MSG_TYPE_ABI);
+        m.account = account;
+        m.abi = raw;
+        m.abi_sequence = abi_sequence;
+        m.abi_hash = fc::sha256::hash(m.abi.data(), m.abi.size());
+        return m;
+      }
+
+      void publish_abi(const account_name& account, const block_state& block) {
+        publish_abi(make_abi_message(account, block));
+      }
+
+      void publish_abi(abi_message&& m) {
+        ilog("[publish_abi] ABI of ${a} is at sequence ${s}", ("a", m.account)("s", m.abi_sequence));
+        send_zmq_message<abi_message>(m);
+        std::lock_guard<std::mutex> g(abi_messages_mtx);
+        abi_messages[m.account.value] = to_json(m);
+      }
+
+      /// For the query thread: the last published ABI, or the current one read on the main thread, which owns the chain db
+      std::string current_abi_json(const account_name& account) {
+        {
+          std::lock_guard<std::mutex> g(abi_messages_mtx);
+          auto itr = abi_messages.find(account.value);
+          if (itr != abi_messages.end()) return itr->second;
+        }
+        auto result = std::make_shared<std::promise<std::string>>();
+        auto future = result->get_future();
+        app().get_io_service().post([this, account, result]() {
+          try {
+            const auto& chain = chain_plug->chain();
+            result->set_value(to_json(make_abi_message(account, *chain.head_block_state())));
+          } catch (...) {
+            result->set_exception(std::current_exception());
+          }
+        });
+        if (future.wait_for(std::chrono::seconds(5)) != std::future_status::ready) {
+          return "{\"error\":\"timed out reading the ABI\"}";
+        }
+        return future.get();
+      }
+
+      /// Forgets setabi txs not applied again since a block that is now irreversible, or included past the age limit
+      void prune_abi_changes(uint32_t irreversible_num) {
+        for (auto itr = abi_changes.begin(); itr != abi_changes.end(); ) {
+          if (itr->second.block_num <= irreversible_num) {
+            abandon_refreshes(itr->second);
+            itr = abi_changes.erase(itr);
+          } else {
+            ++itr;
+          }
+        }
+      }
+
+      /// Watched accounts plus every account with an ABI that matches a watched pattern, which takes a scan of all accounts
+      std::vector<account_name> watched_abi_accounts() {
+        std::vector<account_name> accounts(watched_accounts.begin(), watched_accounts.end());
+        if (!watched_patterns.empty()) {
+          const auto& idx = chain_plug->chain().db().get_index<account_index, by_name>();
+          for (const auto& a : idx) {
+            if (a.abi.size() != 0 && !watched_accounts.count(a.name.value) && watched_patterns.match(a.name.value)) {
+              accounts.push_back(a.name);
+            }
+          }
+        }
+        return accounts;
+      }
+
       void on_irreversible_block(const block_state_ptr& block_state) {
         // ilog("on_irreversible_block: ${i}", ("i", block_state->block->block_num()));
-        transaction_id_type tx_id;
         irreversible_block_message msg;
-        msg.block_num = block_state->block->block_num();
-        msg.timestamp = block_state->block->timestamp;
-        msg.msg_type = MSG_TYPE_IRREVERSIBLE_BLOCK;
+        set_header(msg, *block_state, MSG_TYPE_IRREVERSIBLE_BLOCK);
+        block_transaction_ids(*block_state->block, msg.transactions);
+        send_zmq_message<irreversible_block_message>(msg);
+        prune_abi_changes(msg.block_num);
+        if (query_enabled) {
+          recent_actions.prune(msg.block_num);
+          tx_finality.irreversible(msg.block_num, msg.transactions);
+        }
+      }
 
-        for(const auto& trx : block_state->block->transactions) {
-          if(trx.trx.contains<transaction_id_type>()) {
-            tx_id = trx.trx.get<transaction_id_type>();
+      /**
+       * Answers one JSON request per REP round trip, e.g. {"tx_id":"..."}, {"block_num":123} or
+       * {"account":"chintaitest1","from_block":123,"limit":100}, with {"actions":[...]} or {"error":"..."}.
+       * {"finality":["<tx_id>",...]} is answered with the inclusion block and irreversibility of each emitted tx, and
+       * {"abi":"<account>"} with an abi_message carrying the account's current ABI, and {"stats":{}} with the queue and
+       * drop counters of every endpoint.
+       */
+      std::string handle_query(const std::string& request) {
+        try {
+          auto req = fc::json::from_string(request).get_object();
+          std::vector<std::string> found;
+          if (req.contains("abi")) {
+            return current_abi_json(req["abi"].as<account_name>());
+          }
+          if (req.contains("stats")) {
+            return stats_json();
+          }
+          if (req.contains("finality")) {
+            auto ids = req["finality"].as<std::vector<transaction_id_type>>();
+            uint32_t lib = 0;
+            auto statuses = tx_finality.lookup(ids, lib);
+            fc::variants result;
+            result.reserve(ids.size());
+            for (size_t i = 0; i < ids.size(); ++i) {
+              const auto& st = statuses[i];
+              result.emplace_back(fc::mutable_variant_object("tx_id", ids[i])("known", st.known)
+                                  ("block_num", st.block_num)("irreversible", st.irreversible));
+            }
+            return fc::json::to_string(fc::mutable_variant_object("last_irreversible_block", lib)("finality", result));
+          }
+          if (req.contains("tx_id")) {
+            found = recent_actions.find_tx(req["tx_id"].as<transaction_id_type>());
+          } else if (req.contains("block_num")) {
+            found = recent_actions.find_block(req["block_num"].as<uint32_t>());
+          } else if (req.contains("account")) {
+            found = recent_actions.find_account(req["account"].as<account_name>(),
+                                                req.contains("from_block") ? req["from_block"].as<uint32_t>() : 0,
+                                                req.contains("limit") ? req["limit"].as<uint32_t>() : 1000);
           } else {
-            tx_id = trx.trx.get<packed_transaction>().id();
+            return "{\"error\":\"expected tx_id, block_num or account\"}";
+          }
+          std::string reply = "{\"actions\":[";
+          for (size_t i = 0; i < found.size(); ++i) {
+            if (i) reply += ',';
+            reply += found[i];
+          }
+          reply += "]}";
+          return reply;
+        } catch (const fc::exception& e) {
+          return fc::json::to_string(fc::mutable_variant_object("error", e.to_string()));
+        } catch (const std::exception& e) {
+          return fc::json::to_string(fc::mutable_variant_object("error", e.what()));
+        }
+      }
+
+      /// Endpoint counters are safe to read from the query thread
+      std::string stats_json() {
+        fc::variants eps;
+        for (const auto& ep : endpoints) {
+          eps.emplace_back(fc::mutable_variant_object("bind", ep->address())("attached", ep->attached())("queued", ep->depth())
+                           ("spooled", ep->spooled())("dropped", ep->dropped())("spool_dropped", ep->spool_dropped()));
+        }
+        return fc::json::to_string(fc::mutable_variant_object("endpoints", eps)("shm_dropped", shm_dropped.load()));
+      }
+
+      void serve_queries() {
+        zmq::pollitem_t items[] = { { static_cast<void*>(query_socket), 0, ZMQ_POLLIN, 0 } };
+        while (!query_done) {
+          try {
+            // Wake up regularly so plugin_shutdown doesn't have to tear down the context under us
+            zmq::poll(items, 1, 100);
+            if (!(items[0].revents & ZMQ_POLLIN)) continue;
+            zmq::message_t request;
+            query_socket.recv(&request);
+            std::string reply = handle_query(std::string(static_cast<const char*>(request.data()), request.size()));
+            zmq::message_t message(reply.size());
+            memcpy(message.data(), reply.data(), reply.size());
+            query_socket.send(message);
+          } catch (const zmq::error_t& e) {
+            elog("[serve_queries] ${e}", ("e", e.what()));
           }
-          msg.transactions.push_back(tx_id);
         }
-        send_zmq_message<irreversible_block_message>(msg);
       }
     };
 
@@ -324,21 +1157,164 @@ namespace eosio {
 
    void watcher_plugin::set_program_options(options_description&, options_description& cfg) {
       cfg.add_options()
-      ("watch", bpo::value<vector<string>>()->composing(), "Track actions which match account:action. In case action is not specified, all actions of specified account are tracked.")
+      ("watch", bpo::value<vector<string>>()->composing(), "Track actions which match account:action. In case action is not specified, all actions of specified account are tracked. "
+       "The account may be a prefix* or *suffix pattern, e.g. *.chintai:, to track all actions of every matching account.")
       ("watch-age-limit", bpo::value<int64_t>()->default_value(watcher_plugin_impl::default_age_limit), "Age limit in seconds for blocks to send notifications about. No age limit if set to negative.")
-      (SENDER_BIND, bpo::value<string>()->default_value(SENDER_BIND_DEFAULT), "ZMQ Sender Socket binding");
+      ("watch-table-deltas", bpo::bool_switch()->default_value(false), "Send per-block row deltas (insert/modify/remove) for contract tables owned by watched accounts.")
+      ("watch-table-deltas-decode", bpo::value<bool>()->default_value(true), "Decode table delta rows with the owner's ABI in addition to sending the packed row.")
+      ("watch-aggregate", bpo::value<vector<string>>()->composing(), "Aggregate matched actions as account:action:price_field[:volume_field] into OHLC, volume and count windows.")
+      ("watch-aggregate-windows", bpo::value<string>()->default_value("60,300,3600"), "Comma separated aggregation window lengths in seconds.")
+      ("watch-aggregate-only", bpo::bool_switch()->default_value(false), "Only send block messages that carry matched transactions, relying on aggregate messages for time bucketing.")
+      (QUERY_BIND, bpo::value<string>()->default_value(""), "ZMQ REP socket binding answering lookups of recently sent actions, e.g. ipc:///tmp/watcher-query. Disabled if empty.")
+      ("watch-query-tail-blocks", bpo::value<uint32_t>()->default_value(1200), "Number of irreversible blocks kept below the last irreversible block in the recent action index and for finality lookups.")
+      ("watch-query-max-actions", bpo::value<uint32_t>()->default_value(100000), "Upper bound on the number of actions kept in the recent action index.")
+      (SHM_RING, bpo::value<string>()->default_value(""), "Also write every message to this POSIX shared memory ring, e.g. /eosio-watcher, for consumers on the same host. Disabled if empty.")
+      ("watch-shm-ring-size", bpo::value<uint32_t>()->default_value(64), "Size of the shared memory ring in MiB. Single messages may use up to half of it; larger ones are dropped from the ring and logged.")
+      (FILE_SINK_DIR, bpo::value<string>()->default_value(""), "Also write every message to rotating segment files with a block number and tx id index in this directory, relative to the data dir if not absolute. Disabled if empty.")
+      ("watch-file-sink-segment-size", bpo::value<uint32_t>()->default_value(256), "Size in MiB after which the file sink starts a new segment.")
+      ("watch-file-sink-segments", bpo::value<uint32_t>()->default_value(0), "Number of file sink segments to keep, deleting the oldest. 0 keeps all segments.")
+      (SENDER_BIND, bpo::value<string>()->default_value(SENDER_BIND_DEFAULT), "ZMQ Sender Socket binding. May be followed by ;queue=N and ;overflow=block|drop-oldest|drop-newest.")
+      (FANOUT_BIND, bpo::value<vector<string>>()->composing(), "Additional ZMQ PUSH socket bindings, each receiving the full stream through its own queue and sender thread. Accepts the same ;queue= and ;overflow= suffixes.")
+      (PUB_BIND, bpo::value<string>()->default_value(""), "ZMQ PUB socket binding also receiving the full stream. Slow subscribers lose messages instead of holding up block processing. Disabled if empty.")
+      ("watch-wire-format", bpo::value<string>()->default_value("json"), "Encoding of every message: json, binary (uint32 msg_type followed by the fc::raw packed message) or zlib (compressed json).")
+      ("zmq-sender-queue-size", bpo::value<uint32_t>()->default_value(1000), "Default number of messages queued per ZMQ endpoint.")
+      ("zmq-sender-overflow", bpo::value<string>()->default_value("block"), "Default policy when an endpoint queue is full: block (hold up block processing), drop-oldest or drop-newest.")
+      ("watch-priority-lane", bpo::value<vector<string>>()->composing(), "Comma separated action names sent ahead of other actions, e.g. cancelorder,cancelorderc. Repeat for further lanes, in decreasing priority; unlisted actions and other messages use the last lane. Each lane has its own queue per endpoint.")
+      ("watch-raw-data", bpo::bool_switch()->default_value(false), "Send packed action data and the account's ABI sequence instead of decoded action_data. ABIs of watched accounts are published as msg_type 4 at startup and whenever they change.")
+      ("watch-project", bpo::value<vector<string>>()->composing(), "Only decode and send the listed action_data fields of an action, as [account:]action:field1,field2, e.g. eosio.token:transfer:from,to,quantity. Without an account it applies to the action of every account. Fields the action's ABI lacks are logged when the ABI is loaded.")
+      ("watch-degrade-thresholds", bpo::value<string>()->default_value(""), "Comma separated send queue fill ratios at which messages degrade to packed action data, then drop authorizations, then carry only block and tx ids, e.g. 0.5,0.75,0.9. Disabled if empty.")
+      ("zmq-heartbeat-interval", bpo::value<uint32_t>()->default_value(1000), "ZMTP heartbeat interval in milliseconds; a consumer is considered gone after 3 missed intervals. 0 disables heartbeats.")
+      ("zmq-spool-size", bpo::value<uint32_t>()->default_value(100000), "Messages spooled per endpoint while no consumer is attached, dropping the oldest beyond this. Spooled messages are sent first when a consumer attaches.");
    }
 
    void watcher_plugin::plugin_initialize(const variables_map& options) {
       try {
          string bind_str = options.at(SENDER_BIND).as<string>();
-         if (bind_str.empty())
+         string shm_name = options.at(SHM_RING).as<string>();
+         string file_dir = options.at(FILE_SINK_DIR).as<string>();
+         string pub_bind = options.at(PUB_BIND).as<string>();
+         vector<string> binds;
+         if (!bind_str.empty()) binds.push_back(bind_str);
+         if (options.count(FANOUT_BIND)) {
+           auto fanout = options.at(FANOUT_BIND).as<vector<string>>();
+           binds.insert(binds.end(), fanout.begin(), fanout.end());
+         }
+         if (binds.empty() && pub_bind.empty() && shm_name.empty() && file_dir.empty())
            {
-             wlog("zmq-sender-bind not specified => eosio::watcher_plugin disabled.");
+             wlog("zmq-sender-bind, zmq-fanout-bind, zmq-pub-bind, watch-shm-ring and watch-file-sink-dir not specified => eosio::watcher_plugin disabled.");
              return;
            }
-         ilog("Binding to ${u}", ("u", bind_str));
-         my->sender_socket.bind(bind_str);
+         if (options.count("watch-priority-lane")) {
+            for (auto& lane_actions : options.at("watch-priority-lane").as<vector<string>>()) {
+               std::vector<std::string> acts;
+               boost::split(acts, lane_actions, boost::is_any_of(","));
+               for (auto& a : acts) {
+                  boost::trim(a);
+                  if (a.empty()) continue;
+                  EOS_ASSERT(my->action_lanes.emplace(name(a).value, my->default_lane).second, fc::invalid_arg_exception,
+                  "Action ${a} listed in more than one --watch-priority-lane", ("a", a));
+               }
+               ++my->default_lane;
+            }
+         }
+
+         my->raw_data = options.at("watch-raw-data").as<bool>();
+
+         if (options.count("watch-project")) {
+            for (auto& p : options.at("watch-project").as<vector<string>>()) {
+               std::vector<std::string> parts;
+               boost::split(parts, p, boost::is_any_of(":"));
+               EOS_ASSERT((parts.size() == 2 || parts.size() == 3) && !parts.front().empty() && !parts.back().empty() &&
+               (parts.size() == 2 || !parts[1].empty()), fc::invalid_arg_exception, "Invalid value ${p} for --watch-project", ("p", p));
+               const uint64_t account = parts.size() == 3 ? name(parts[0]).value : 0;
+               std::vector<std::string> fields;
+               boost::split(fields, parts.back(), boost::is_any_of(","));
+               auto& projected = my->projections[std::make_pair(account, name(parts[parts.size() - 2]).value)];
+               for (auto& f : fields) {
+                  boost::trim(f);
+                  if (!f.empty()) projected.insert(f);
+               }
+            }
+         }
+
+         std::vector<std::string> thresholds;
+         boost::split(thresholds, options.at("watch-degrade-thresholds").as<string>(), boost::is_any_of(","));
+         for (auto& t : thresholds) {
+            boost::trim(t);
+            if (t.empty()) continue;
+            double v = 0;
+            try {
+               v = std::stod(t);
+            } catch (const std::exception& e) {
+               EOS_THROW(fc::invalid_arg_exception, "Invalid ratio ${t} for watch-degrade-thresholds: ${e}", ("t", t)("e", e.what()));
+            }
+            EOS_ASSERT(v > 0 && (my->degrade_thresholds.empty() || v > my->degrade_thresholds.back()) && my->degrade_thresholds.size() < DEGRADE_IDS_ONLY,
+            fc::invalid_arg_exception, "watch-degrade-thresholds needs up to 3 increasing ratios, got ${t}", ("t", t));
+            my->degrade_thresholds.push_back(v);
+         }
+
+         zmq_endpoint::config endpoint_defaults;
+         endpoint_defaults.lanes = my->default_lane + 1;
+         endpoint_defaults.queue_size = options.at("zmq-sender-queue-size").as<uint32_t>();
+         endpoint_defaults.heartbeat_ms = options.at("zmq-heartbeat-interval").as<uint32_t>();
+         endpoint_defaults.spool_size = options.at("zmq-spool-size").as<uint32_t>();
+         endpoint_defaults.on_attach_change = [](const std::string& bind, bool attached, uint64_t spool_dropped) {
+           if (!attached) wlog("No consumer attached to ${b}, spooling messages", ("b", bind));
+           else if (spool_dropped) wlog("Consumer attached to ${b}, draining spooled messages; the spool was full and dropped the oldest ${n} of them, raise zmq-spool-size", ("b", bind)("n", spool_dropped));
+           else ilog("Consumer attached to ${b}, draining spooled messages", ("b", bind));
+         };
+         try {
+           endpoint_defaults.overflow = zmq_endpoint::parse_overflow(options.at("zmq-sender-overflow").as<string>());
+         } catch (const std::invalid_argument& e) {
+           EOS_THROW(fc::invalid_arg_exception, "Invalid value for zmq-sender-overflow: ${e}", ("e", e.what()));
+         }
+         for (const auto& b : binds) {
+           zmq_endpoint::config cfg;
+           try {
+             cfg = zmq_endpoint::parse(b, endpoint_defaults);
+           } catch (const std::exception& e) {
+             EOS_THROW(fc::invalid_arg_exception, "Invalid ZMQ endpoint ${b}: ${e}", ("b", b)("e", e.what()));
+           }
+           ilog("Binding to ${u}", ("u", cfg.bind));
+           my->endpoints.emplace_back(new zmq_endpoint(my->context, cfg));
+         }
+         if (!pub_bind.empty()) {
+           ilog("Publishing to ${u}", ("u", pub_bind));
+           int linger = 0;
+           my->pub_socket.setsockopt(ZMQ_LINGER, &linger, sizeof(linger));
+           my->pub_socket.bind(pub_bind);
+           my->pub_enabled = true;
+         }
+         if (!shm_name.empty()) {
+           uint64_t ring_size = options.at("watch-shm-ring-size").as<uint32_t>() * uint64_t(1024 * 1024);
+           ilog("Writing to shared memory ring ${n} of ${s} bytes", ("n", shm_name)("s", ring_size));
+           try {
+             my->shm_ring.reset(new shm_ring_writer(shm_name, ring_size));
+           } catch (const std::exception& e) {
+             EOS_THROW(fc::invalid_arg_exception, "Unable to create shared memory ring ${n}: ${e}", ("n", shm_name)("e", e.what()));
+           }
+         }
+         if (!file_dir.empty()) {
+           file_sink::config cfg;
+           boost::filesystem::path dir(file_dir);
+           cfg.dir = (dir.is_relative() ? app().data_dir() / dir : dir).generic_string();
+           cfg.segment_size = options.at("watch-file-sink-segment-size").as<uint32_t>() * uint64_t(1024 * 1024);
+           cfg.max_segments = options.at("watch-file-sink-segments").as<uint32_t>();
+           ilog("Writing message segments to ${d}", ("d", cfg.dir));
+           try {
+             my->file_out.reset(new file_sink(cfg));
+           } catch (const std::exception& e) {
+             EOS_THROW(fc::invalid_arg_exception, "Unable to open file sink in ${d}: ${e}", ("d", cfg.dir)("e", e.what()));
+           }
+         }
+
+         wire_format format;
+         try {
+           format = parse_wire_format(options.at("watch-wire-format").as<string>());
+         } catch (const std::invalid_argument& e) {
+           EOS_THROW(fc::invalid_arg_exception, "Invalid value for watch-wire-format: ${e}", ("e", e.what()));
+         }
+         my->pipeline = watcher_plugin_impl::select_pipeline(format, my->active_transports());
 
          if (options.count("watch")) {
             auto fo = options.at("watch").as<vector<string>>();
@@ -349,16 +1325,68 @@ namespace eosio {
                EOS_ASSERT(v.size() == 2, fc::invalid_arg_exception,
                "Invalid value ${s} for --watch",
                ("s", s));
+               if (name_pattern_set::is_pattern(v[0])) {
+                  EOS_ASSERT(v[1].empty(), fc::invalid_arg_exception,
+                  "Invalid value ${s} for --watch, account patterns match whole accounts only", ("s", s));
+                  try {
+                     my->watched_patterns.add(v[0]);
+                  } catch (const std::invalid_argument& e) {
+                     EOS_THROW(fc::invalid_arg_exception, "Invalid value ${s} for --watch: ${e}", ("s", s)("e", e.what()));
+                  }
+                  continue;
+               }
                watcher_plugin_impl::filter_entry fe{v[0], v[1]};
                EOS_ASSERT(fe.receiver.value, fc::invalid_arg_exception, "Invalid value ${s} for "
                "--watch", ("s", s));
                my->filter_on.insert(fe);
+               if (fe.action == name()) my->watched_accounts.insert(fe.receiver.value);
             }
          }
 
          if (options.count("watch-age-limit"))
          my->age_limit = options.at("watch-age-limit").as<int64_t>();
 
+         my->table_deltas = options.at("watch-table-deltas").as<bool>();
+         my->table_deltas_decode = options.at("watch-table-deltas-decode").as<bool>();
+
+         if (options.count("watch-aggregate")) {
+            for (auto& s : options.at("watch-aggregate").as<vector<string>>()) {
+               std::vector<std::string> v;
+               boost::split(v, s, boost::is_any_of(":"));
+               EOS_ASSERT((v.size() == 3 || v.size() == 4) && !v[0].empty() && !v[1].empty() && !v[2].empty(),
+               fc::invalid_arg_exception, "Invalid value ${s} for --watch-aggregate", ("s", s));
+               my->aggregator.add_spec({v[0], v[1], v[2], v.size() == 4 ? v[3] : std::string()});
+            }
+            std::vector<std::string> w;
+            std::vector<uint32_t> windows;
+            boost::split(w, options.at("watch-aggregate-windows").as<string>(), boost::is_any_of(","));
+            for (auto& secs : w) {
+               boost::trim(secs);
+               if (secs.empty()) continue;
+               unsigned long len = 0;
+               size_t end = 0;
+               try {
+                  len = std::stoul(secs, &end);
+               } catch (const std::exception& e) {
+                  EOS_THROW(fc::invalid_arg_exception, "Invalid window ${w} for --watch-aggregate-windows: ${e}", ("w", secs)("e", e.what()));
+               }
+               EOS_ASSERT(end == secs.size() && len > 0 && len <= UINT32_MAX, fc::invalid_arg_exception, "Invalid window ${w} for --watch-aggregate-windows", ("w", secs));
+               windows.push_back(len);
+            }
+            my->aggregator.set_windows(std::move(windows));
+         }
+         my->aggregate_only = options.at("watch-aggregate-only").as<bool>();
+
+         string query_bind = options.at(QUERY_BIND).as<string>();
+         if (!query_bind.empty()) {
+            ilog("Binding query socket to ${u}", ("u", query_bind));
+            my->query_socket.bind(query_bind);
+            my->recent_actions.tail_blocks = options.at("watch-query-tail-blocks").as<uint32_t>();
+            my->tx_finality.tail_blocks = my->recent_actions.tail_blocks;
+            my->recent_actions.max_entries = options.at("watch-query-max-actions").as<uint32_t>();
+            my->query_enabled = true;
+         }
+
          my->chain_plug = app().find_plugin<chain_plugin>();
          auto& chain = my->chain_plug->chain();
          my->accepted_block_conn.emplace(chain.accepted_block.connect(
@@ -380,18 +1408,46 @@ namespace eosio {
    }
 
    void watcher_plugin::plugin_startup() {
-
+      std::vector<account_name> abi_accounts;
+      if (my->chain_plug) {
+         abi_accounts = my->watched_abi_accounts();
+         // Build serializers now rather than on the first actions after a restart
+         for (auto account : abi_accounts) {
+            try {
+               auto serializer = my->get_serializer(account);
+               for (const auto& p : my->projections) {
+                  if (p.first.first != 0 && p.first.first != account.value) continue;
+                  if (serializer && serializer->get_action_type(name(p.first.second)) != type_name()) {
+                     my->projection_for(account, name(p.first.second), p.second);
+                  }
+               }
+            } catch (const fc::exception& e) {
+               wlog("Unable to load ABI of ${a}: ${e}", ("a", account)("e", e.to_string()));
+            }
+         }
+      }
+      if (my->raw_data && my->chain_plug) {
+         // Consumers decode for themselves in raw mode, so they start with every watched ABI
+         const auto& chain = my->chain_plug->chain();
+         for (auto account : abi_accounts) {
+            my->publish_abi(account, *chain.head_block_state());
+         }
+      }
+      if (my->query_enabled) {
+         my->query_thread = std::thread([this]() { my->serve_queries(); });
+      }
    }
 
    void watcher_plugin::plugin_shutdown() {
       my->applied_tx_conn.reset();
       my->accepted_block_conn.reset();
       my->irreversible_block_conn.reset();
+      if (my->query_thread.joinable()) {
+         my->query_done = true;
+         my->query_thread.join();
+      }
+      // Sends what is still queued, bounded by each endpoint's drain time
+      my->endpoints.clear();
    }
 
 }
-
-FC_REFLECT(eosio::watcher_plugin_impl::action_notif, (account)(name)(authorization)(action_data))
-FC_REFLECT(eosio::watcher_plugin_impl::message, (block_num)(timestamp)(transactions)(msg_type))
-FC_REFLECT(eosio::watcher_plugin_impl::irreversible_block_message, (block_num)(timestamp)(transactions)(msg_type))
-FC_REFLECT(eosio::watcher_plugin_impl::transaction, (tx_id)(actions))
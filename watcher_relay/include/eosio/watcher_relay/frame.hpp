@@ -0,0 +1,182 @@
+/**
+ *  @file
+ *  @copyright eosauthority - free to use and modify - see LICENSE.txt
+ *
+ *  What the relay needs to know about a watcher_plugin frame without decoding it: the message header, read straight
+ *  from the encoded bytes, plus zlib helpers matching the plugin's zlib wire format.
+ */
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#include <zlib.h>
+
+namespace eosio {
+
+   /// Mirrors the plugin's watch-wire-format
+   enum class frame_encoding { json, binary, zlib };
+
+   inline frame_encoding parse_frame_encoding( const std::string& s ) {
+      if( s == "json" ) return frame_encoding::json;
+      if( s == "binary" ) return frame_encoding::binary;
+      if( s == "zlib" ) return frame_encoding::zlib;
+      throw std::invalid_argument( "frame encoding must be json, binary or zlib" );
+   }
+
+   /// The header every message starts with, plus where the type specific fields begin
+   struct frame_info {
+      uint32_t msg_type = 0;
+      uint32_t block_num = 0;
+      char     block_id[32] = {};
+      char     previous[32] = {};
+      uint64_t seq = 0;
+      size_t   seq_offset = 0;    // where the seq value is encoded, see restamp_seq
+      size_t   seq_size = 0;
+      size_t   body = 0;          // offset of the first byte after the header
+   };
+
+   namespace frame_detail {
+      inline bool parse_uint( const char* p, const char* end, uint32_t& value, const char** next = nullptr ) {
+         if( p == end || *p < '0' || *p > '9' ) return false;
+         uint64_t v = 0;
+         while( p != end && *p >= '0' && *p <= '9' && v <= UINT32_MAX ) v = v * 10 + (*p++ - '0');
+         if( v > UINT32_MAX ) return false;
+         value = uint32_t(v);
+         if( next ) *next = p;
+         return true;
+      }
+
+      /// Advances @ref p past @ref literal if the frame continues with it
+      inline bool expect( const char*& p, const char* end, const char* literal ) {
+         const size_t n = strlen( literal );
+         if( size_t(end - p) < n || memcmp(p, literal, n) != 0 ) return false;
+         p += n;
+         return true;
+      }
+
+      /// A uint64, quoted by the plugin's json beyond 32 bits
+      inline bool parse_uint64( const char* p, const char* end, uint64_t& value, const char** next ) {
+         const bool quoted = p != end && *p == '"';
+         if( quoted ) ++p;
+         if( p == end || *p < '0' || *p > '9' ) return false;
+         uint64_t v = 0;
+         for( ; p != end && *p >= '0' && *p <= '9'; ++p ) {
+            if( v > (UINT64_MAX - 9) / 10 ) return false;
+            v = v * 10 + (*p - '0');
+         }
+         if( quoted && (p == end || *p++ != '"') ) return false;
+         value = v;
+         *next = p;
+         return true;
+      }
+
+      inline int hex_value( char c ) {
+         if( c >= '0' && c <= '9' ) return c - '0';
+         if( c >= 'a' && c <= 'f' ) return c - 'a' + 10;
+         return -1;
+      }
+
+      inline bool parse_hex( const char* p, const char* end, char* out, size_t out_len ) {
+         if( size_t(end - p) < out_len * 2 ) return false;
+         for( size_t i = 0; i < out_len; ++i ) {
+            const int hi = hex_value( p[2 * i] ), lo = hex_value( p[2 * i + 1] );
+            if( hi < 0 || lo < 0 ) return false;
+            out[i] = char( (hi << 4) | lo );
+         }
+         return true;
+      }
+   }
+
+   /// Size of the binary header: msg_type prefix, then the packed block_num, block_id, previous, timestamp, msg_type, seq
+   const size_t binary_header_size = 4 + 4 + 32 + 32 + 8 + 4 + 8;
+
+   /**
+    * Reads the header of a json or binary frame. Every message starts with block_num, block_id, previous, timestamp,
+    * msg_type and seq, in that order, so this never looks past them.
+    */
+   inline bool read_frame_info( const char* data, size_t len, frame_encoding encoding, frame_info& info ) {
+      using namespace frame_detail;
+      if( encoding == frame_encoding::binary ) {
+         if( len < binary_header_size ) return false;
+         memcpy( &info.msg_type, data, 4 );
+         memcpy( &info.block_num, data + 4, 4 );
+         memcpy( info.block_id, data + 8, 32 );
+         memcpy( info.previous, data + 40, 32 );
+         info.seq_offset = 84;
+         info.seq_size = 8;
+         memcpy( &info.seq, data + info.seq_offset, 8 );
+         info.body = binary_header_size;
+         return true;
+      }
+      const char* p = data;
+      const char* end = data + len;
+      if( !expect(p, end, "{\"block_num\":") || !parse_uint(p, end, info.block_num, &p) ) return false;
+      if( !expect(p, end, ",\"block_id\":\"") || !parse_hex(p, end, info.block_id, sizeof(info.block_id)) ) return false;
+      p += 2 * sizeof(info.block_id);
+      if( !expect(p, end, "\",\"previous\":\"") || !parse_hex(p, end, info.previous, sizeof(info.previous)) ) return false;
+      p += 2 * sizeof(info.previous);
+      if( !expect(p, end, "\",\"timestamp\":\"") ) return false;
+      p = static_cast<const char*>( memchr(p, '"', end - p) );
+      if( !p ) return false;
+      ++p;
+      if( !expect(p, end, ",\"msg_type\":") || !parse_uint(p, end, info.msg_type, &p) ) return false;
+      if( !expect(p, end, ",\"seq\":") ) return false;
+      info.seq_offset = p - data;
+      if( !parse_uint64(p, end, info.seq, &p) ) return false;
+      info.seq_size = p - data - info.seq_offset;
+      info.body = p - data;
+      return true;
+   }
+
+   /// Copy of a plain frame with its seq replaced, for streams put together from several others
+   inline std::string restamp_seq( const char* data, size_t len, frame_encoding encoding, const frame_info& info, uint64_t seq ) {
+      std::string out;
+      if( encoding == frame_encoding::binary ) {
+         out.assign( data, len );
+         memcpy( &out[info.seq_offset], &seq, sizeof(seq) );
+         return out;
+      }
+      const std::string digits = std::to_string( seq );
+      out.reserve( len + 24 );
+      out.append( data, info.seq_offset );
+      if( seq > 0xffffffffull ) out += '"' + digits + '"';
+      else out += digits;
+      out.append( data + info.seq_offset + info.seq_size, len - info.seq_offset - info.seq_size );
+      return out;
+   }
+
+   inline void zlib_inflate( const char* data, size_t len, std::string& out ) {
+      z_stream zs;
+      memset( &zs, 0, sizeof(zs) );
+      if( inflateInit(&zs) != Z_OK ) throw std::runtime_error( "inflateInit failed" );
+      zs.next_in = reinterpret_cast<Bytef*>( const_cast<char*>(data) );
+      zs.avail_in = len;
+      out.resize( std::max<size_t>(len * 4, 256) );
+      size_t produced = 0;
+      int rc;
+      do {
+         if( produced == out.size() ) out.resize( out.size() * 2 );
+         zs.next_out = reinterpret_cast<Bytef*>( &out[produced] );
+         zs.avail_out = out.size() - produced;
+         rc = inflate( &zs, Z_NO_FLUSH );
+         produced = out.size() - zs.avail_out;
+      } while( rc == Z_OK );
+      inflateEnd( &zs );
+      if( rc != Z_STREAM_END ) throw std::runtime_error( "corrupt zlib frame" );
+      out.resize( produced );
+   }
+
+   /// Same stream format as the plugin's zlib frames: a zlib stream at best speed
+   inline std::string zlib_deflate( const char* data, size_t len ) {
+      uLongf out_len = compressBound( len );
+      std::string out( out_len, '\0' );
+      if( compress2(reinterpret_cast<Bytef*>(&out[0]), &out_len, reinterpret_cast<const Bytef*>(data), len, Z_BEST_SPEED) != Z_OK )
+         throw std::runtime_error( "compress2 failed" );
+      out.resize( out_len );
+      return out;
+   }
+
+}
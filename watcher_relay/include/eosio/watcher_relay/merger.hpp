@@ -0,0 +1,226 @@
+/**
+ *  @file
+ *  @copyright eosauthority - free to use and modify - see LICENSE.txt
+ */
+#pragma once
+#include <eosio/watcher_relay/frame.hpp>
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <map>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+namespace eosio {
+
+   /**
+    * Merges the streams of several nodeos instances running the plugin into one, forwarding whichever copy of a message
+    * arrives first. Consumers get the latency of the fastest node and keep receiving while any node is up.
+    *
+    * Messages are identified by their header: block messages by block id and lane, table deltas and aggregates by
+    * block id, ABI messages by account and ABI sequence. A block message carries every matched transaction of its block,
+    * so deduping it dedupes its transactions. Blocks of competing forks have different ids and are all forwarded, as a
+    * single node switching forks would send them; only the number of such blocks is counted. Irreversible messages are
+    * deduped by block number, a second node reporting a different irreversible id is reported and not forwarded.
+    *
+    * Identities are remembered for @ref config::window_blocks blocks below the highest block seen. Frames older than that
+    * come from a node lagging behind and were forwarded from another one already, so they are dropped. ABI messages are
+    * the exception: a node publishes every watched ABI again at its head block when it restarts, so their identities are
+    * kept for as long as the merger runs, one per setabi of a watched account.
+    */
+   class stream_merger {
+   public:
+      struct config {
+         frame_encoding encoding = frame_encoding::json;   // of the plain frames passed to accept()
+         uint32_t       window_blocks = 1200;
+         std::function<void(const std::string& notice)> on_notice;
+      };
+
+      struct stats {
+         uint64_t frames_in = 0;
+         uint64_t forwarded = 0;
+         uint64_t duplicates = 0;
+         uint64_t stale = 0;
+         uint64_t forks = 0;          // blocks forwarded for a block number that already had one
+         uint64_t conflicts = 0;      // irreversible blocks reported with different ids
+         uint64_t malformed = 0;
+         std::vector<uint64_t> first_from;  // per source, frames it delivered first
+      };
+
+      stream_merger( const config& c, size_t sources ) : cfg(c) {
+         totals.first_from.resize( sources );
+      }
+
+      /// Whether the frame is the first copy of its message, in which case it is to be forwarded
+      bool accept( size_t source, const char* data, size_t len ) {
+         ++totals.frames_in;
+         frame_info info;
+         key k;
+         if( !read_frame_info(data, len, cfg.encoding, info) || !make_key(data, len, info, k) ) {
+            ++totals.malformed;
+            return false;
+         }
+         if( info.msg_type == msg_type_abi ) {
+            if( !abis_seen.insert(k).second ) {
+               ++totals.duplicates;
+               return false;
+            }
+            ++totals.forwarded;
+            ++totals.first_from[source];
+            return true;
+         }
+         if( head > cfg.window_blocks && info.block_num < head - cfg.window_blocks ) {
+            ++totals.stale;
+            return false;
+         }
+
+         auto& entry = blocks[info.block_num];
+         if( info.msg_type == msg_type_irreversible ) {
+            if( entry.irreversible ) {
+               if( memcmp(entry.irreversible_id, info.block_id, sizeof(info.block_id)) == 0 ) {
+                  ++totals.duplicates;
+               } else {
+                  ++totals.conflicts;
+                  notice( "source " + std::to_string(source) + " reports a different irreversible block " +
+                          std::to_string(info.block_num) + ", not forwarded" );
+               }
+               return false;
+            }
+            entry.irreversible = true;
+            memcpy( entry.irreversible_id, info.block_id, sizeof(info.block_id) );
+         } else {
+            if( !seen.insert(k).second ) {
+               ++totals.duplicates;
+               return false;
+            }
+            entry.keys.push_back( k );
+            if( info.msg_type == msg_type_block && !entry.has_block_id(info.block_id) ) {
+               entry.block_ids.emplace_back();
+               memcpy( entry.block_ids.back().data(), info.block_id, sizeof(info.block_id) );
+               if( entry.block_ids.size() > 1 ) {
+                  ++totals.forks;
+                  notice( "fork at block " + std::to_string(info.block_num) + " from source " + std::to_string(source) );
+               }
+            }
+         }
+
+         ++totals.forwarded;
+         ++totals.first_from[source];
+         if( info.block_num > head ) {
+            head = info.block_num;
+            prune();
+         }
+         return true;
+      }
+
+      const stats& counters()const { return totals; }
+
+   private:
+      static const uint32_t msg_type_block = 0;
+      static const uint32_t msg_type_irreversible = 1;
+      static const uint32_t msg_type_abi = 4;
+
+      struct key {
+         uint32_t msg_type = 0;
+         uint32_t block_num = 0;
+         uint32_t lane = 0;
+         char     id[32] = {};
+
+         friend bool operator==( const key& a, const key& b ) {
+            return a.msg_type == b.msg_type && a.block_num == b.block_num && a.lane == b.lane &&
+                   memcmp( a.id, b.id, sizeof(a.id) ) == 0;
+         }
+      };
+
+      struct key_hash {
+         size_t operator()( const key& k )const {
+            // Block ids start with the block number, the bytes after it are hash output; ABI identities end with the
+            // ABI sequence, which is mixed in so the sequences of one account spread out
+            uint64_t h, tail;
+            memcpy( &h, k.id + 8, sizeof(h) );
+            memcpy( &tail, k.id + 16, sizeof(tail) );
+            return h ^ tail * 0x9e3779b97f4a7c15ull ^ (uint64_t(k.msg_type) << 56) ^ (uint64_t(k.lane) << 48) ^ k.block_num;
+         }
+      };
+
+      struct block_entry {
+         std::vector<std::array<char, 32>> block_ids;   // of the block messages forwarded, more than one on forks
+         bool                              irreversible = false;
+         char                              irreversible_id[32];
+         std::vector<key>                  keys;
+
+         bool has_block_id( const char* id )const {
+            for( const auto& b : block_ids ) if( memcmp(b.data(), id, b.size()) == 0 ) return true;
+            return false;
+         }
+      };
+
+      bool make_key( const char* data, size_t len, const frame_info& info, key& k )const {
+         using namespace frame_detail;
+         k.msg_type = info.msg_type;
+         const char* p = data + info.body;
+         const char* end = data + len;
+         if( info.msg_type == msg_type_abi ) {
+            // Nodes publish the ABIs of watched accounts at their own head block when they start
+            return read_abi_identity( p, end, k.id );
+         }
+         k.block_num = info.block_num;
+         memcpy( k.id, info.block_id, sizeof(k.id) );
+         if( info.msg_type == msg_type_block ) {
+            if( cfg.encoding == frame_encoding::binary ) {
+               if( size_t(end - p) < sizeof(k.lane) ) return false;
+               memcpy( &k.lane, p, sizeof(k.lane) );
+            } else if( !expect(p, end, ",\"lane\":") || !parse_uint(p, end, k.lane) ) {
+               return false;
+            }
+         }
+         return true;
+      }
+
+      /// Account and ABI sequence, which directly follow the header of ABI messages
+      bool read_abi_identity( const char* p, const char* end, char* id )const {
+         using namespace frame_detail;
+         if( cfg.encoding == frame_encoding::binary ) {
+            if( end - p < 16 ) return false;
+            memcpy( id, p, 16 );
+            return true;
+         }
+         if( !expect(p, end, ",\"account\":\"") ) return false;
+         const char* q = static_cast<const char*>( memchr(p, '"', end - p) );
+         if( !q || q - p > 13 ) return false;
+         memcpy( id, p, q - p );
+         p = q + 1;
+         if( !expect(p, end, ",\"abi_sequence\":") ) return false;
+         if( p != end && *p == '"' ) ++p;   // quoted beyond 32 bits
+         uint64_t seq = 0;
+         if( p == end || *p < '0' || *p > '9' ) return false;
+         while( p != end && *p >= '0' && *p <= '9' ) seq = seq * 10 + (*p++ - '0');
+         memcpy( id + 16, &seq, sizeof(seq) );
+         return true;
+      }
+
+      void prune() {
+         if( head <= cfg.window_blocks ) return;
+         const uint32_t floor = head - cfg.window_blocks;
+         while( !blocks.empty() && blocks.begin()->first < floor ) {
+            for( const auto& k : blocks.begin()->second.keys ) seen.erase( k );
+            blocks.erase( blocks.begin() );
+         }
+      }
+
+      void notice( const std::string& text ) {
+         if( cfg.on_notice ) cfg.on_notice( text );
+      }
+
+      config                              cfg;
+      stats                               totals;
+      uint32_t                            head = 0;
+      std::unordered_set<key, key_hash>   seen;
+      std::unordered_set<key, key_hash>   abis_seen;  // never pruned, see the class comment
+      std::map<uint32_t, block_entry>     blocks;
+   };
+
+}
@@ -0,0 +1,294 @@
+/**
+ *  @file
+ *  @copyright eosauthority - free to use and modify - see LICENSE.txt
+ */
+#pragma once
+#include <eosio/watcher_plugin/zmq_endpoint.hpp>
+#include <eosio/watcher_plugin/file_sink.hpp>
+#include <eosio/watcher_relay/frame.hpp>
+#include <eosio/watcher_relay/spool_reader.hpp>
+
+#include <zmq.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace eosio {
+
+   /**
+    * Takes the plugin's stream off one local PULL socket and does the downstream work in its own process: fan-out to
+    * any number of consumers, each with its own queue, overflow policy, msg_type/account filter and optional zlib
+    * compression, plus a segment spool on disk that consumers can page through with replay requests.
+    *
+    * Frames are relayed unchanged apart from compression. zlib input is inflated once so filters see plain frames;
+    * consumers without compress=zlib get the plain JSON, those with it get the source's compressed bytes as received.
+    */
+   class relay {
+   public:
+      struct consumer_config {
+         zmq_endpoint::config     endpoint;
+         std::set<uint32_t>       msg_types;   // empty passes every msg_type
+         std::vector<std::string> accounts;    // block messages (msg_type 0) must contain "account":"<name>" for one of
+                                               // these, anywhere in the text, empty passes all. Needs a text source
+         bool                     compress = false;
+      };
+
+      struct config {
+         std::string                  source;                       // address of the plugin's PUSH socket
+         frame_encoding               source_encoding = frame_encoding::json;
+         std::vector<consumer_config> consumers;
+         file_sink::config            spool;                        // disabled with an empty dir
+         std::string                  replay_bind;                  // REP socket answering replay requests, disabled if empty
+         size_t                       max_replay_frames = 10000;    // per reply
+      };
+
+      struct stats {
+         uint64_t frames_in = 0;
+         uint64_t bytes_in = 0;
+         uint64_t frames_out = 0;
+         uint64_t filtered = 0;
+         uint64_t malformed = 0;
+      };
+
+      /**
+       * Parses `endpoint[;queue=N][;overflow=...][;types=0,1][;accounts=a,b][;compress=zlib]`. The queue and overflow
+       * options are those of zmq_endpoint, the rest select what the consumer receives and how. `accounts` searches the
+       * message text, so it is rejected for a binary @ref source.
+       */
+      static consumer_config parse_consumer( const std::string& spec, const zmq_endpoint::config& defaults, frame_encoding source ) {
+         consumer_config c;
+         std::string endpoint_spec;
+         size_t start = 0, end;
+         do {
+            end = spec.find(';', start);
+            const std::string part = spec.substr( start, end == std::string::npos ? std::string::npos : end - start );
+            if( part.compare(0, 6, "types=") == 0 ) {
+               for( const auto& t : split(part.substr(6)) ) c.msg_types.insert( std::stoul(t) );
+            } else if( part.compare(0, 9, "accounts=") == 0 ) {
+               if( source == frame_encoding::binary ) {
+                  throw std::invalid_argument( "accounts= needs a json or zlib source, binary messages can't be searched for accounts" );
+               }
+               c.accounts = split( part.substr(9) );
+            } else if( part == "compress=zlib" ) {
+               c.compress = true;
+            } else {
+               endpoint_spec += (endpoint_spec.empty() ? "" : ";") + part;
+            }
+            start = end + 1;
+         } while( end != std::string::npos );
+         c.endpoint = zmq_endpoint::parse( endpoint_spec, defaults );
+         return c;
+      }
+
+      relay( zmq::context_t& context, const config& c )
+      : cfg(c), source(context, ZMQ_PULL), replay(context, ZMQ_REP) {
+         for( auto& consumer : cfg.consumers ) {
+            outputs.emplace_back( new output{ consumer, std::unique_ptr<zmq_endpoint>(new zmq_endpoint(context, consumer.endpoint)), {} } );
+            for( const auto& a : consumer.accounts ) outputs.back()->account_keys.push_back( "\"account\":\"" + a + "\"" );
+         }
+         if( !cfg.spool.dir.empty() ) {
+            spool.reset( new file_sink(cfg.spool) );
+            spool_frames.reset( new spool_reader(cfg.spool.dir) );
+         }
+         int linger = 0;
+         replay.setsockopt( ZMQ_LINGER, &linger, sizeof(linger) );
+         if( !cfg.replay_bind.empty() ) replay.bind( cfg.replay_bind );
+         source.setsockopt( ZMQ_LINGER, &linger, sizeof(linger) );
+         source.connect( cfg.source );
+      }
+
+      relay( const relay& ) = delete;
+      relay& operator=( const relay& ) = delete;
+
+      /// Safe to call from any thread
+      stats counters()const {
+         stats s;
+         s.frames_in = frames_in.load( std::memory_order_relaxed );
+         s.bytes_in = bytes_in.load( std::memory_order_relaxed );
+         s.frames_out = frames_out.load( std::memory_order_relaxed );
+         s.filtered = filtered.load( std::memory_order_relaxed );
+         s.malformed = malformed.load( std::memory_order_relaxed );
+         return s;
+      }
+
+      /// Relays until @ref done is set, checking it at least every 100ms
+      void run( const std::atomic<bool>& done ) {
+         zmq::pollitem_t items[] = { { static_cast<void*>(source), 0, ZMQ_POLLIN, 0 },
+                                     { static_cast<void*>(replay), 0, ZMQ_POLLIN, 0 } };
+         const int count = cfg.replay_bind.empty() ? 1 : 2;
+         while( !done ) {
+            zmq::poll( items, count, 100 );
+            if( items[0].revents & ZMQ_POLLIN ) {
+               // Drain what is queued before polling again, polling per frame would dominate at high rates
+               zmq::message_t msg;
+               while( source.recv(&msg, ZMQ_DONTWAIT) ) {
+                  relay_frame( static_cast<const char*>(msg.data()), msg.size() );
+               }
+            }
+            if( count > 1 && (items[1].revents & ZMQ_POLLIN) ) answer_replay();
+         }
+      }
+
+      /// One frame as received from the plugin
+      void relay_frame( const char* data, size_t len ) {
+         frames_in.fetch_add( 1, std::memory_order_relaxed );
+         bytes_in.fetch_add( len, std::memory_order_relaxed );
+         shared_frame plain, compressed;
+         if( cfg.source_encoding == frame_encoding::zlib ) {
+            std::string inflated;
+            try {
+               zlib_inflate( data, len, inflated );
+            } catch( const std::exception& ) {
+               malformed.fetch_add( 1, std::memory_order_relaxed );
+               return;
+            }
+            plain = std::make_shared<const std::string>( std::move(inflated) );
+            compressed = std::make_shared<const std::string>( data, len );
+         } else {
+            plain = std::make_shared<const std::string>( data, len );
+         }
+         frame_info info;
+         if( !read_frame_info(plain->data(), plain->size(), plain_encoding(), info) ) {
+            malformed.fetch_add( 1, std::memory_order_relaxed );
+            return;
+         }
+
+         for( auto& out : outputs ) {
+            if( !wanted(*out, info, *plain) ) {
+               filtered.fetch_add( 1, std::memory_order_relaxed );
+               continue;
+            }
+            if( out->cfg.compress && !compressed ) {
+               compressed = std::make_shared<const std::string>( zlib_deflate(plain->data(), plain->size()) );
+            }
+            out->endpoint->push( out->cfg.compress ? compressed : plain );
+            frames_out.fetch_add( 1, std::memory_order_relaxed );
+         }
+         if( spool ) {
+            file_sink::frame f;
+            f.block_num = info.block_num;
+            f.msg_type = info.msg_type;
+            f.payload = *plain;
+            spool->push( std::move(f) );
+         }
+      }
+
+      /**
+       * Answers {"from_block":N}, {"from_seq":N} or {"cursor":"S:R"}, each with an optional "limit", with a multipart
+       * reply: the spooled frames in the order they were received, then {"cursor":"S:R","frames":K} to continue from.
+       */
+      void answer_replay() {
+         zmq::message_t request;
+         if( !replay.recv(&request, ZMQ_DONTWAIT) ) return;
+         const std::string req( static_cast<const char*>(request.data()), request.size() );
+         std::vector<std::string> frames;
+         std::string trailer;
+         if( !spool_frames ) {
+            trailer = "{\"error\":\"no spool configured\"}";
+         } else {
+            spool_reader::cursor from;
+            uint32_t block_num, limit;
+            uint64_t seq;
+            if( parse_field(req, "\"from_block\":", block_num) ) {
+               from = spool_frames->find_block( block_num );
+            } else if( parse_seq(req, seq) ) {
+               from = spool_frames->find_seq( seq, plain_encoding() );
+            } else if( !parse_cursor(req, from) ) {
+               trailer = "{\"error\":\"expected from_block, from_seq or cursor\"}";
+            }
+            if( trailer.empty() ) {
+               size_t max = cfg.max_replay_frames;
+               if( parse_field(req, "\"limit\":", limit) ) max = std::min<size_t>( max, limit );
+               from = spool_frames->read( from, max, frames );
+               trailer = "{\"cursor\":\"" + std::to_string(from.segment) + ":" + std::to_string(from.record) +
+                         "\",\"frames\":" + std::to_string(frames.size()) + "}";
+            }
+         }
+         for( auto& f : frames ) {
+            zmq::message_t part( f.size() );
+            memcpy( part.data(), f.data(), f.size() );
+            replay.send( part, ZMQ_SNDMORE );
+         }
+         zmq::message_t last( trailer.size() );
+         memcpy( last.data(), trailer.data(), trailer.size() );
+         replay.send( last );
+      }
+
+   private:
+      struct output {
+         consumer_config               cfg;
+         std::unique_ptr<zmq_endpoint> endpoint;
+         std::vector<std::string>      account_keys; // "account":"<name>" for each filtered account
+      };
+
+      frame_encoding plain_encoding()const {
+         return cfg.source_encoding == frame_encoding::binary ? frame_encoding::binary : frame_encoding::json;
+      }
+
+      bool wanted( const output& out, const frame_info& info, const std::string& frame )const {
+         if( !out.cfg.msg_types.empty() && !out.cfg.msg_types.count(info.msg_type) ) return false;
+         if( out.account_keys.empty() || info.msg_type != 0 || plain_encoding() != frame_encoding::json ) return true;
+         for( const auto& key : out.account_keys ) {
+            if( frame.find(key) != std::string::npos ) return true;
+         }
+         return false;
+      }
+
+      static std::vector<std::string> split( const std::string& s ) {
+         std::vector<std::string> result;
+         size_t start = 0, end;
+         do {
+            end = s.find(',', start);
+            auto item = s.substr( start, end == std::string::npos ? std::string::npos : end - start );
+            if( !item.empty() ) result.push_back( item );
+            start = end + 1;
+         } while( end != std::string::npos );
+         return result;
+      }
+
+      static bool parse_field( const std::string& req, const char* key, uint32_t& value ) {
+         auto pos = req.find( key );
+         if( pos == std::string::npos ) return false;
+         pos += strlen( key );
+         while( pos < req.size() && req[pos] == ' ' ) ++pos;
+         return frame_detail::parse_uint( req.data() + pos, req.data() + req.size(), value );
+      }
+
+      static bool parse_seq( const std::string& req, uint64_t& seq ) {
+         static const char key[] = "\"from_seq\":";
+         auto pos = req.find( key );
+         if( pos == std::string::npos ) return false;
+         pos += sizeof(key) - 1;
+         while( pos < req.size() && req[pos] == ' ' ) ++pos;
+         const char* next;
+         return frame_detail::parse_uint64( req.data() + pos, req.data() + req.size(), seq, &next );
+      }
+
+      static bool parse_cursor( const std::string& req, spool_reader::cursor& c ) {
+         auto pos = req.find( "\"cursor\":\"" );
+         if( pos == std::string::npos ) return false;
+         unsigned long long record;
+         if( sscanf(req.c_str() + pos + 10, "%u:%llu", &c.segment, &record) != 2 ) return false;
+         c.record = record;
+         return true;
+      }
+
+      config                                cfg;
+      zmq::socket_t                         source;
+      zmq::socket_t                         replay;
+      std::vector<std::unique_ptr<output>>  outputs;
+      std::unique_ptr<file_sink>            spool;
+      std::unique_ptr<spool_reader>         spool_frames;
+      std::atomic<uint64_t>                 frames_in{0};
+      std::atomic<uint64_t>                 bytes_in{0};
+      std::atomic<uint64_t>                 frames_out{0};
+      std::atomic<uint64_t>                 filtered{0};
+      std::atomic<uint64_t>                 malformed{0};
+   };
+
+}
@@ -0,0 +1,176 @@
+/**
+ *  @file
+ *  @copyright eosauthority - free to use and modify - see LICENSE.txt
+ */
+#pragma once
+#include <eosio/watcher_plugin/file_sink.hpp>
+#include <eosio/watcher_relay/frame.hpp>
+
+#include <algorithm>
+#include <cstdio>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace eosio {
+
+   /**
+    * Reads frames back from the segment files a file_sink writes, in the order they were received.
+    *
+    * Positions are cursors of (segment, index record), so paging through a spool never skips frames of a fork that
+    * arrived after higher block numbers. The writer may append and rotate concurrently; a segment deleted under the
+    * reader is skipped. Indexes of closed segments, every one but the newest, are read once and kept, so a reader is
+    * used from one thread.
+    */
+   class spool_reader {
+   public:
+      struct cursor {
+         uint32_t segment = 0;
+         uint64_t record = 0;
+      };
+
+      explicit spool_reader( std::string dir ) : dir(std::move(dir)) {}
+
+      /// Position of the first frame of a block at or above @ref block_num, or the end of the spool
+      cursor find_block( uint32_t block_num )const {
+         const auto segments = list_segments();
+         for( auto n : segments ) {
+            const auto& records = *segment_index( n, segments );
+            for( uint64_t i = 0; i < records.size(); ++i ) {
+               if( is_message(records[i]) && records[i].block_num >= block_num ) return cursor{ n, i };
+            }
+         }
+         return segments.empty() ? cursor{} : cursor{ segments.back() + 1, 0 };
+      }
+
+      /**
+       * Position of the first message with a seq at or above @ref seq, found by binary search as seq increases through
+       * the spool. Only for spools of plain frames of one stream, like the relay's.
+       */
+      cursor find_seq( uint64_t seq, frame_encoding encoding )const {
+         const auto segments = list_segments();
+         for( auto n : segments ) {
+            const auto index = segment_index( n, segments );
+            const auto& records = *index;
+            std::vector<uint64_t> messages;
+            for( uint64_t i = 0; i < records.size(); ++i ) if( is_message(records[i]) ) messages.push_back( i );
+            if( messages.empty() ) continue;
+            const int fd = ::open( path(n, "log").c_str(), O_RDONLY );
+            if( fd < 0 ) continue;
+            auto seq_at = [&]( uint64_t i ) {
+               frame_info info;
+               std::string payload;
+               return read_payload(fd, records[i], payload) &&
+                      read_frame_info(payload.data(), payload.size(), encoding, info) ? info.seq : UINT64_MAX;
+            };
+            size_t lo = 0, hi = messages.size();
+            while( lo < hi ) {
+               const size_t mid = lo + (hi - lo) / 2;
+               if( seq_at(messages[mid]) < seq ) lo = mid + 1;
+               else hi = mid;
+            }
+            ::close( fd );
+            if( lo < messages.size() ) return cursor{ n, messages[lo] };
+         }
+         return segments.empty() ? cursor{} : cursor{ segments.back() + 1, 0 };
+      }
+
+      /// Appends up to @ref max_frames frames starting at @ref from to @ref frames, returns the position after them
+      cursor read( cursor from, size_t max_frames, std::vector<std::string>& frames )const {
+         const auto segments = list_segments();
+         for( auto n : segments ) {
+            if( n < from.segment ) continue;
+            if( n > from.segment ) from = cursor{ n, 0 };
+            const auto index = segment_index( n, segments );
+            const auto& records = *index;
+            if( from.record >= records.size() ) continue;
+            const int fd = ::open( path(n, "log").c_str(), O_RDONLY );
+            if( fd < 0 ) continue;
+            for( ; from.record < records.size() && frames.size() < max_frames; ++from.record ) {
+               const auto& rec = records[from.record];
+               if( !is_message(rec) ) continue;
+               std::string payload;
+               if( !read_payload(fd, rec, payload) ) break;
+               frames.emplace_back( std::move(payload) );
+            }
+            ::close( fd );
+            if( frames.size() >= max_frames ) break;
+         }
+         return from;
+      }
+
+   private:
+      typedef std::vector<file_sink::index_record> segment_records;
+
+      /// The writer closes a segment before it creates the next one, so only the newest of @ref segments still grows
+      std::shared_ptr<const segment_records> segment_index( uint32_t n, const std::vector<uint32_t>& segments )const {
+         // Segments rotated away since the last request
+         closed_indexes.erase( closed_indexes.begin(), closed_indexes.lower_bound(segments.empty() ? 0 : segments.front()) );
+         const bool closed = n != segments.back();
+         if( closed ) {
+            auto itr = closed_indexes.find( n );
+            if( itr != closed_indexes.end() ) return itr->second;
+         }
+         auto records = std::make_shared<const segment_records>( read_index(n) );
+         if( closed ) closed_indexes[n] = records;
+         return records;
+      }
+
+      static bool is_message( const file_sink::index_record& rec ) {
+         static const char zero[sizeof(rec.tx_id)] = {};
+         return memcmp( rec.tx_id, zero, sizeof(zero) ) == 0;
+      }
+
+      static bool read_payload( int fd, const file_sink::index_record& rec, std::string& payload ) {
+         uint32_t len;
+         if( pread(fd, &len, sizeof(len), rec.offset) != ssize_t(sizeof(len)) ) return false;
+         payload.resize( len );
+         return pread( fd, &payload[0], len, rec.offset + sizeof(len) ) == ssize_t(len);
+      }
+
+      std::string path( uint32_t n, const char* ext )const {
+         char buf[32];
+         snprintf( buf, sizeof(buf), "/segment-%08u.%s", n, ext );
+         return dir + buf;
+      }
+
+      std::vector<uint32_t> list_segments()const {
+         std::vector<uint32_t> result;
+         if( DIR* d = opendir(dir.c_str()) ) {
+            while( dirent* e = readdir(d) ) {
+               uint32_t n;
+               char ext[4];
+               if( sscanf(e->d_name, "segment-%8u.%3s", &n, ext) == 2 && strcmp(ext, "idx") == 0 ) result.push_back( n );
+            }
+            closedir(d);
+         }
+         std::sort( result.begin(), result.end() );
+         return result;
+      }
+
+      /// Whole records only, the writer may be in the middle of appending one
+      std::vector<file_sink::index_record> read_index( uint32_t n )const {
+         std::vector<file_sink::index_record> records;
+         const int fd = ::open( path(n, "idx").c_str(), O_RDONLY );
+         if( fd < 0 ) return records;
+         struct stat st;
+         if( fstat(fd, &st) == 0 ) {
+            records.resize( st.st_size / sizeof(file_sink::index_record) );
+            const ssize_t want = records.size() * sizeof(file_sink::index_record);
+            const ssize_t got = pread( fd, records.data(), want, 0 );
+            records.resize( got > 0 ? got / sizeof(file_sink::index_record) : 0 );
+         }
+         ::close( fd );
+         return records;
+      }
+
+      std::string dir;
+      mutable std::map<uint32_t, std::shared_ptr<const segment_records>> closed_indexes;
+   };
+
+}
@@ -0,0 +1,236 @@
+/**
+ *  @file
+ *  @copyright eosauthority - free to use and modify - see LICENSE.txt
+ */
+#include <eosio/watcher_relay/merger.hpp>
+#include <eosio/watcher_relay/spool_reader.hpp>
+#include <eosio/watcher_plugin/file_sink.hpp>
+#include <eosio/watcher_plugin/zmq_endpoint.hpp>
+
+#include <zmq.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace {
+   std::atomic<bool> done{false};
+
+   void on_signal( int ) { done = true; }
+
+   void usage() {
+      std::cerr <<
+         "Usage: watcher_merger (--source <address> ... | --replay <dir> ...) (--bind <spec> | --out-dir <dir>) [options]\n"
+         "\n"
+         "  --source <address>             PUSH socket of one watcher_plugin, repeat for every nodeos\n"
+         "  --replay <dir>                 Segment files recorded from one nodeos (watch-file-sink-dir or a relay\n"
+         "                                 spool), repeat for every nodeos. Frames are interleaved one by one and the\n"
+         "                                 merger exits when all are read\n"
+         "  --format <format>              json, binary or zlib, as set by watch-wire-format on every node (default json)\n"
+         "  --bind <spec>                  PUSH socket for the merged stream: address[;queue=N][;overflow=...]\n"
+         "  --out-dir <dir>                Write the merged stream to segment files here\n"
+         "  --window-blocks <n>            Blocks below the highest one seen to dedupe over (default 1200)\n"
+         "  --queue-size <n>               Frames queued for --bind (default 1000)\n"
+         "  --overflow <policy>            block, drop-oldest or drop-newest (default block)\n"
+         "  --heartbeat-interval <ms>      ZMTP heartbeat interval, 0 disables (default 1000)\n"
+         "  --stats-interval <seconds>     Print counters, 0 disables (default 10)\n";
+   }
+
+   /// Where merged frames go
+   struct output {
+      std::unique_ptr<eosio::zmq_endpoint> endpoint;
+      std::unique_ptr<eosio::file_sink>    sink;
+
+      void send( std::string&& frame, const eosio::frame_info& info ) {
+         auto shared = std::make_shared<const std::string>( std::move(frame) );
+         if( endpoint ) endpoint->push( shared );
+         if( sink ) {
+            eosio::file_sink::frame f;
+            f.block_num = info.block_num;
+            f.msg_type = info.msg_type;
+            f.payload = *shared;
+            sink->push( std::move(f) );
+         }
+      }
+   };
+
+   /// Runs the merger on one received frame and forwards it if it is the first copy
+   class merge_step {
+   public:
+      merge_step( const eosio::stream_merger::config& c, size_t sources, eosio::frame_encoding encoding, output& out )
+      : merger(c, sources), encoding(encoding), out(out) {}
+
+      void operator()( size_t source, const char* data, size_t len ) {
+         const char* plain = data;
+         size_t plain_len = len;
+         if( encoding == eosio::frame_encoding::zlib ) {
+            try {
+               eosio::zlib_inflate( data, len, inflated );
+            } catch( const std::exception& ) {
+               inflated.clear();
+            }
+            plain = inflated.data();
+            plain_len = inflated.size();
+         }
+         if( merger.accept(source, plain, plain_len) ) {
+            // Each node numbers its own stream, the merged one gets a sequence of its own
+            eosio::frame_info info;
+            eosio::read_frame_info( plain, plain_len, merger_encoding(), info );
+            std::string frame = eosio::restamp_seq( plain, plain_len, merger_encoding(), info, next_seq++ );
+            if( encoding == eosio::frame_encoding::zlib ) frame = eosio::zlib_deflate( frame.data(), frame.size() );
+            out.send( std::move(frame), info );
+         }
+      }
+
+      eosio::frame_encoding merger_encoding()const {
+         return encoding == eosio::frame_encoding::binary ? eosio::frame_encoding::binary : eosio::frame_encoding::json;
+      }
+
+      const eosio::stream_merger::stats& counters()const { return merger.counters(); }
+
+   private:
+      eosio::stream_merger  merger;
+      eosio::frame_encoding encoding;
+      output&               out;
+      std::string           inflated;
+      uint64_t              next_seq = std::chrono::duration_cast<std::chrono::microseconds>(
+                                          std::chrono::system_clock::now().time_since_epoch()).count();
+   };
+
+   void print_stats( const eosio::stream_merger::stats& s ) {
+      fprintf( stderr, "in %llu, forwarded %llu, duplicates %llu, stale %llu, forks %llu, conflicts %llu, malformed %llu, first from",
+               (unsigned long long)s.frames_in, (unsigned long long)s.forwarded, (unsigned long long)s.duplicates,
+               (unsigned long long)s.stale, (unsigned long long)s.forks, (unsigned long long)s.conflicts,
+               (unsigned long long)s.malformed );
+      for( auto n : s.first_from ) fprintf( stderr, " %llu", (unsigned long long)n );
+      fprintf( stderr, "\n" );
+   }
+}
+
+int main( int argc, char** argv ) {
+   using namespace eosio;
+
+   std::vector<std::string> sources, replays;
+   std::string bind, out_dir;
+   frame_encoding encoding = frame_encoding::json;
+   stream_merger::config merger_cfg;
+   zmq_endpoint::config endpoint_defaults;
+   uint32_t stats_interval = 10;
+
+   try {
+      for( int i = 1; i < argc; ++i ) {
+         const std::string arg = argv[i];
+         if( arg == "--help" || arg == "-h" ) {
+            usage();
+            return 0;
+         }
+         if( i + 1 >= argc ) throw std::invalid_argument( arg + " needs a value" );
+         const std::string value = argv[++i];
+         if( arg == "--source" ) sources.push_back( value );
+         else if( arg == "--replay" ) replays.push_back( value );
+         else if( arg == "--format" ) encoding = parse_frame_encoding( value );
+         else if( arg == "--bind" ) bind = value;
+         else if( arg == "--out-dir" ) out_dir = value;
+         else if( arg == "--window-blocks" ) merger_cfg.window_blocks = std::stoul( value );
+         else if( arg == "--queue-size" ) endpoint_defaults.queue_size = std::stoul( value );
+         else if( arg == "--overflow" ) endpoint_defaults.overflow = zmq_endpoint::parse_overflow( value );
+         else if( arg == "--heartbeat-interval" ) endpoint_defaults.heartbeat_ms = std::stoi( value );
+         else if( arg == "--stats-interval" ) stats_interval = std::stoul( value );
+         else throw std::invalid_argument( "unknown option " + arg );
+      }
+      if( sources.empty() == replays.empty() ) throw std::invalid_argument( "either --source or --replay is required" );
+      if( bind.empty() && out_dir.empty() ) throw std::invalid_argument( "--bind or --out-dir is required" );
+   } catch( const std::exception& e ) {
+      std::cerr << "watcher_merger: " << e.what() << "\n\n";
+      usage();
+      return 1;
+   }
+
+   std::signal( SIGINT, on_signal );
+   std::signal( SIGTERM, on_signal );
+
+   merger_cfg.encoding = encoding == frame_encoding::binary ? frame_encoding::binary : frame_encoding::json;
+   merger_cfg.on_notice = []( const std::string& text ) { std::cerr << "watcher_merger: " << text << std::endl; };
+
+   try {
+      zmq::context_t context(1);
+      output out;
+      if( !bind.empty() ) {
+         endpoint_defaults.on_attach_change = []( const std::string& b, bool attached, uint64_t spool_dropped ) {
+            std::cerr << (attached ? "Consumer attached to " : "No consumer attached to ") << b << std::endl;
+            if( spool_dropped ) std::cerr << "The spool of " << b << " was full, " << spool_dropped << " oldest messages were dropped" << std::endl;
+         };
+         out.endpoint.reset( new zmq_endpoint(context, zmq_endpoint::parse(bind, endpoint_defaults)) );
+      }
+      if( !out_dir.empty() ) {
+         file_sink::config sink_cfg;
+         sink_cfg.dir = out_dir;
+         out.sink.reset( new file_sink(sink_cfg) );
+      }
+      merge_step step( merger_cfg, sources.size() + replays.size(), encoding, out );
+      auto next_stats = std::chrono::steady_clock::now() + std::chrono::seconds( stats_interval );
+
+      if( !replays.empty() ) {
+         // Recorded streams have no arrival times, so they are interleaved one frame at a time
+         std::vector<spool_reader> readers;
+         std::vector<spool_reader::cursor> cursors( replays.size() );
+         std::vector<std::vector<std::string>> pending( replays.size() );
+         std::vector<size_t> positions( replays.size() );
+         for( const auto& dir : replays ) readers.emplace_back( dir );
+         bool any = true;
+         while( any && !done ) {
+            any = false;
+            for( size_t s = 0; s < readers.size(); ++s ) {
+               if( positions[s] == pending[s].size() ) {
+                  pending[s].clear();
+                  positions[s] = 0;
+                  cursors[s] = readers[s].read( cursors[s], 1000, pending[s] );
+                  if( pending[s].empty() ) continue;
+               }
+               const auto& f = pending[s][positions[s]++];
+               step( s, f.data(), f.size() );
+               any = true;
+            }
+         }
+      } else {
+         std::vector<std::unique_ptr<zmq::socket_t>> sockets;
+         std::vector<zmq::pollitem_t> items;
+         int linger = 0;
+         for( const auto& address : sources ) {
+            sockets.emplace_back( new zmq::socket_t(context, ZMQ_PULL) );
+            sockets.back()->setsockopt( ZMQ_LINGER, &linger, sizeof(linger) );
+            sockets.back()->connect( address );
+            items.push_back( { static_cast<void*>(*sockets.back()), 0, ZMQ_POLLIN, 0 } );
+         }
+         zmq::message_t msg;
+         while( !done ) {
+            zmq::poll( items.data(), items.size(), 100 );
+            // One frame per source and pass, so a burst on one node doesn't delay the other's copies
+            bool any = true;
+            while( any && !done ) {
+               any = false;
+               for( size_t s = 0; s < sockets.size(); ++s ) {
+                  if( sockets[s]->recv(&msg, ZMQ_DONTWAIT) ) {
+                     step( s, static_cast<const char*>(msg.data()), msg.size() );
+                     any = true;
+                  }
+               }
+            }
+            if( stats_interval && std::chrono::steady_clock::now() >= next_stats ) {
+               print_stats( step.counters() );
+               next_stats += std::chrono::seconds( stats_interval );
+            }
+         }
+      }
+      print_stats( step.counters() );
+   } catch( const std::exception& e ) {
+      std::cerr << "watcher_merger: " << e.what() << std::endl;
+      return 1;
+   }
+   return 0;
+}
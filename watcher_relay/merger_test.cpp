@@ -0,0 +1,212 @@
+/**
+ *  @file
+ *  @copyright eosauthority - free to use and modify - see LICENSE.txt
+ *
+ *  stream_merger fed with the streams of two nodes built by hand: the same blocks from both, a fork only one of them
+ *  saw, a node lagging past the window, irreversible blocks with conflicting ids and ABIs announced again after a
+ *  restart. Exits with 1 if a counter or the set of forwarded frames is not what a single node would have sent.
+ */
+#include <eosio/watcher_relay/merger.hpp>
+
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace {
+   using namespace eosio;
+
+   uint32_t failures = 0;
+
+   void expect( bool ok, const std::string& what ) {
+      if( ok ) return;
+      ++failures;
+      std::cerr << "FAILED: " << what << "\n";
+   }
+
+   /// Block id as the chain builds it: the block number in the first 4 bytes, then bytes standing in for the hash
+   std::string block_id( uint32_t block_num, uint32_t fork = 0 ) {
+      char buf[65];
+      snprintf( buf, sizeof(buf), "%08x%08x%048x", block_num, 0x5eed0000u + fork, block_num * 7919u + fork );
+      return buf;
+   }
+
+   std::string header( uint32_t block_num, uint32_t msg_type, uint64_t seq, uint32_t fork = 0 ) {
+      return "{\"block_num\":" + std::to_string(block_num) + ",\"block_id\":\"" + block_id(block_num, fork) +
+             "\",\"previous\":\"" + block_id(block_num - 1, fork) + "\",\"timestamp\":\"2026-10-17T05:00:00.000\"" +
+             ",\"msg_type\":" + std::to_string(msg_type) + ",\"seq\":" + std::to_string(seq);
+   }
+
+   std::string block( uint32_t block_num, uint64_t seq, uint32_t fork = 0 ) {
+      return header( block_num, 0, seq, fork ) + ",\"lane\":0,\"degraded\":0,\"transactions\":[]}";
+   }
+
+   std::string irreversible( uint32_t block_num, uint64_t seq, uint32_t fork = 0 ) {
+      return header( block_num, 1, seq, fork ) + "}";
+   }
+
+   std::string abi( uint32_t block_num, uint64_t seq, const std::string& account, uint64_t abi_sequence ) {
+      return header( block_num, 4, seq ) + ",\"account\":\"" + account + "\",\"abi_sequence\":" +
+             std::to_string(abi_sequence) + ",\"abi_hash\":\"00\",\"abi\":\"\"}";
+   }
+
+   struct node {
+      size_t                   source;
+      std::vector<std::string> frames;
+      uint64_t                 seq;
+
+      void push_block( uint32_t block_num, uint32_t fork = 0 ) { frames.push_back( block(block_num, seq++, fork) ); }
+      void push_irreversible( uint32_t block_num, uint32_t fork = 0 ) { frames.push_back( irreversible(block_num, seq++, fork) ); }
+      void push_abi( uint32_t block_num, const std::string& account, uint64_t abi_sequence ) {
+         frames.push_back( abi(block_num, seq++, account, abi_sequence) );
+      }
+   };
+
+   /// Feeds every frame of @ref n, appending those the merger forwards to @ref forwarded
+   void feed( stream_merger& merger, const node& n, std::vector<std::string>& forwarded ) {
+      for( const auto& f : n.frames ) {
+         if( merger.accept(n.source, f.data(), f.size()) ) forwarded.push_back( f );
+      }
+   }
+
+   /// Interleaves the frames of @ref a and @ref b one by one and returns those the merger forwards
+   std::vector<std::string> merge( stream_merger& merger, const node& a, const node& b ) {
+      std::vector<std::string> forwarded;
+      for( size_t i = 0; i < std::max(a.frames.size(), b.frames.size()); ++i ) {
+         for( const auto* n : { &a, &b } ) {
+            if( i >= n->frames.size() ) continue;
+            const auto& f = n->frames[i];
+            if( merger.accept(n->source, f.data(), f.size()) ) forwarded.push_back( f );
+         }
+      }
+      return forwarded;
+   }
+
+   uint32_t count_of( const std::vector<std::string>& frames, const std::string& frame ) {
+      uint32_t n = 0;
+      for( const auto& f : frames ) n += f == frame;
+      return n;
+   }
+
+   /// Both nodes send blocks 1-20 and the same irreversible blocks: each message is forwarded once
+   void duplicates() {
+      stream_merger merger( stream_merger::config(), 2 );
+      node a{ 0, {}, 1000 }, b{ 1, {}, 5000 };
+      for( uint32_t n = 1; n <= 20; ++n ) {
+         a.push_block( n );
+         b.push_block( n );
+         if( n > 5 ) {
+            a.push_irreversible( n - 5 );
+            b.push_irreversible( n - 5 );
+         }
+      }
+      const auto out = merge( merger, a, b );
+      const auto& s = merger.counters();
+      expect( out.size() == 35, "duplicates: expected 35 frames forwarded, got " + std::to_string(out.size()) );
+      expect( s.duplicates == 35, "duplicates: expected 35 duplicates, got " + std::to_string(s.duplicates) );
+      expect( s.first_from[0] == 35 && s.first_from[1] == 0, "duplicates: node 0 delivers every frame first" );
+      for( const auto& f : a.frames ) expect( count_of(out, f) == 1, "duplicates: node 0 frame not forwarded once" );
+      expect( s.forks == 0 && s.conflicts == 0 && s.stale == 0 && s.malformed == 0, "duplicates: unexpected counters" );
+   }
+
+   /// Node 1 briefly follows a fork at blocks 11-12: both branches are forwarded, each once, and counted as forks
+   void competing_forks() {
+      stream_merger merger( stream_merger::config(), 2 );
+      node a{ 0, {}, 1000 }, b{ 1, {}, 5000 };
+      for( uint32_t n = 1; n <= 15; ++n ) {
+         a.push_block( n );
+         b.push_block( n, n == 11 || n == 12 ? 1 : 0 );
+      }
+      // Node 1 switches back to the fork node 0 followed
+      b.push_block( 11 );
+      b.push_block( 12 );
+      const auto out = merge( merger, a, b );
+      const auto& s = merger.counters();
+      expect( out.size() == 17, "fork: expected 17 frames forwarded, got " + std::to_string(out.size()) );
+      expect( s.forks == 2, "fork: expected 2 forks, got " + std::to_string(s.forks) );
+      expect( count_of(out, block(11, 5010, 1)) == 1 && count_of(out, block(12, 5011, 1)) == 1,
+              "fork: blocks of the other branch are forwarded" );
+      expect( s.duplicates == 15, "fork: expected 15 duplicates, got " + std::to_string(s.duplicates) );
+   }
+
+   /// Node 1 runs 30 blocks behind node 0 with a window of 20: its frames arrive below the window and are stale
+   void lagging_node() {
+      stream_merger::config cfg;
+      cfg.window_blocks = 20;
+      stream_merger merger( cfg, 2 );
+      node a{ 0, {}, 1000 }, b{ 1, {}, 5000 };
+      std::vector<std::string> out;
+      for( uint32_t n = 1; n <= 100; ++n ) {
+         a.push_block( n );
+         if( n > 30 ) b.push_block( n - 30 );
+         feed( merger, a, out );
+         a.frames.clear();
+         std::vector<std::string> lagging;
+         feed( merger, b, lagging );
+         b.frames.clear();
+         expect( lagging.empty(), "lagging node: block " + std::to_string(n - 30) + " forwarded at head " + std::to_string(n) );
+      }
+      const auto& s = merger.counters();
+      expect( out.size() == 100 && s.forwarded == 100, "lagging node: expected the 100 blocks of node 0 forwarded" );
+      expect( s.stale == 70, "lagging node: expected 70 stale, got " + std::to_string(s.stale) );
+      expect( s.first_from[0] == 100 && s.first_from[1] == 0, "lagging node: every first copy comes from node 0" );
+   }
+
+   /// The nodes report different irreversible ids for block 30: the second one is a conflict and not forwarded
+   void conflicting_lib() {
+      std::vector<std::string> notices;
+      stream_merger::config cfg;
+      cfg.on_notice = [&]( const std::string& text ) { notices.push_back( text ); };
+      stream_merger merger( cfg, 2 );
+      node a{ 0, {}, 1000 }, b{ 1, {}, 5000 };
+      a.push_block( 40 );
+      b.push_block( 40 );
+      a.push_irreversible( 30 );
+      b.push_irreversible( 30, 1 );
+      a.push_irreversible( 31 );
+      b.push_irreversible( 31 );
+      const auto out = merge( merger, a, b );
+      const auto& s = merger.counters();
+      expect( s.conflicts == 1, "conflicting LIB: expected 1 conflict, got " + std::to_string(s.conflicts) );
+      expect( count_of(out, irreversible(30, 1001)) == 1 && count_of(out, irreversible(30, 5001, 1)) == 0,
+              "conflicting LIB: only the first irreversible id is forwarded" );
+      expect( out.size() == 3 && s.duplicates == 2, "conflicting LIB: expected 3 frames forwarded and 2 duplicates" );
+      expect( notices.size() == 1, "conflicting LIB: expected one notice, got " + std::to_string(notices.size()) );
+   }
+
+   /// Node 1 restarts 100 blocks later and announces its ABIs again: only the new ABI sequence is forwarded
+   void abi_after_restart() {
+      stream_merger::config cfg;
+      cfg.window_blocks = 20;
+      stream_merger merger( cfg, 2 );
+      node a{ 0, {}, 1000 }, b{ 1, {}, 5000 };
+      a.push_abi( 10, "eosio.token", 3 );
+      b.push_abi( 10, "eosio.token", 3 );
+      for( uint32_t n = 10; n <= 110; ++n ) a.push_block( n );
+      b.push_abi( 110, "eosio.token", 3 );
+      b.push_abi( 110, "chintaitest1", 7 );
+      // Node 0 has moved the window past block 10 by the time node 1 is back
+      std::vector<std::string> out;
+      feed( merger, a, out );
+      feed( merger, b, out );
+      const auto& s = merger.counters();
+      expect( count_of(out, abi(10, 1000, "eosio.token", 3)) == 1, "ABI after restart: first announcement forwarded" );
+      expect( count_of(out, abi(110, 5001, "eosio.token", 3)) == 0, "ABI after restart: repeated ABI forwarded" );
+      expect( count_of(out, abi(110, 5002, "chintaitest1", 7)) == 1, "ABI after restart: new ABI not forwarded" );
+      expect( s.duplicates == 2, "ABI after restart: expected 2 duplicates, got " + std::to_string(s.duplicates) );
+   }
+}
+
+int main() {
+   duplicates();
+   competing_forks();
+   lagging_node();
+   conflicting_lib();
+   abi_after_restart();
+   if( failures ) {
+      std::cerr << failures << " checks failed\n";
+      return 1;
+   }
+   std::cout << "stream_merger forwards each message once\n";
+   return 0;
+}
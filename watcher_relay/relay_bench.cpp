@@ -0,0 +1,157 @@
+/**
+ *  @file
+ *  @copyright eosauthority - free to use and modify - see LICENSE.txt
+ *
+ *  Throughput of the relay on one host: a producer standing in for the plugin pushes synthetic block frames, the relay
+ *  fans them out to PULL consumers over ipc, and the time until every consumer has every frame is reported.
+ */
+#include <eosio/watcher_relay/relay.hpp>
+
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+   struct options {
+      uint64_t    frames = 200000;
+      size_t      frame_size = 2048;
+      uint32_t    consumers = 4;
+      bool        compress = false;
+      std::string spool_dir;
+   };
+
+   /// A block message shaped like the plugin's json output, header first, padded with transactions up to about @ref size bytes
+   std::string make_frame( uint32_t block_num, size_t size ) {
+      const char* hex = "0123456789abcdef";
+      std::string f = "{\"block_num\":" + std::to_string(block_num) +
+                      ",\"block_id\":\"" + std::string(64, hex[block_num & 15]) +
+                      "\",\"previous\":\"" + std::string(64, hex[(block_num - 1) & 15]) +
+                      "\",\"timestamp\":\"2018-06-14T12:00:00.000\",\"msg_type\":0,\"seq\":" + std::to_string(block_num) +
+                      ",\"lane\":0,\"degraded\":0,\"transactions\":[";
+      for( uint32_t i = 0; f.size() < size; ++i ) {
+         if( i ) f += ',';
+         f += "{\"tx_id\":\"" + std::string(64, hex[(block_num + i) & 15]) +
+              "\",\"actions\":[{\"account\":\"eosio.token\",\"name\":\"transfer\",\"global_sequence\":" + std::to_string(i) +
+              ",\"authorization\":[{\"actor\":\"eosauthority\",\"permission\":\"active\"}],\"action_data\":{"
+              "\"from\":\"eosauthority\",\"to\":\"chintaitest1\",\"quantity\":\"" + std::to_string(i) +
+              ".0000 EOS\",\"memo\":\"bench\"}}]}";
+      }
+      return f + "]}";
+   }
+
+   void usage() {
+      std::cerr <<
+         "Usage: watcher_relay_bench [--frames N] [--frame-size BYTES] [--consumers N] [--compress] [--spool-dir DIR]\n";
+   }
+}
+
+int main( int argc, char** argv ) {
+   using namespace eosio;
+   options opt;
+   try {
+      for( int i = 1; i < argc; ++i ) {
+         const std::string arg = argv[i];
+         if( arg == "--compress" ) { opt.compress = true; continue; }
+         if( arg == "--help" || arg == "-h" || i + 1 >= argc ) { usage(); return arg == "--help" || arg == "-h" ? 0 : 1; }
+         const std::string value = argv[++i];
+         if( arg == "--frames" ) opt.frames = std::stoull( value );
+         else if( arg == "--frame-size" ) opt.frame_size = std::stoul( value );
+         else if( arg == "--consumers" ) opt.consumers = std::stoul( value );
+         else if( arg == "--spool-dir" ) opt.spool_dir = value;
+         else { usage(); return 1; }
+      }
+   } catch( const std::exception& e ) {
+      std::cerr << "watcher_relay_bench: " << e.what() << std::endl;
+      return 1;
+   }
+
+   // A few distinct frames are enough, the relay never caches by content
+   std::vector<std::string> frames;
+   for( uint32_t i = 0; i < 16; ++i ) frames.push_back( make_frame(i + 1, opt.frame_size) );
+   // The relay drops frames it can't read the header of, the consumers would then wait forever
+   frame_info info;
+   if( !read_frame_info(frames[0].data(), frames[0].size(), frame_encoding::json, info) ) {
+      std::cerr << "watcher_relay_bench: the synthetic frames don't have the message header the relay reads" << std::endl;
+      return 1;
+   }
+
+   zmq::context_t context(1);
+   const std::string source = "inproc://watcher-relay-bench-source";
+   zmq::socket_t producer( context, ZMQ_PUSH );
+   int linger = 0;
+   producer.setsockopt( ZMQ_LINGER, &linger, sizeof(linger) );
+   producer.bind( source );
+
+   // The endpoints find attached consumers with a socket monitor, which needs a connection oriented transport
+   relay::config cfg;
+   cfg.source = source;
+   cfg.spool.dir = opt.spool_dir;
+   std::vector<std::string> addresses;
+   for( uint32_t i = 0; i < opt.consumers; ++i ) {
+      addresses.push_back( "ipc:///tmp/watcher-relay-bench-" + std::to_string(getpid()) + "-" + std::to_string(i) );
+      relay::consumer_config c;
+      c.endpoint.bind = addresses.back();
+      c.compress = opt.compress;
+      cfg.consumers.push_back( c );
+   }
+
+   std::atomic<bool> done{false};
+   std::atomic<uint32_t> finished{0};
+   std::vector<uint64_t> received( opt.consumers, 0 );
+   std::vector<std::thread> consumers;
+   try {
+      relay r( context, cfg );
+      std::thread relay_thread( [&]() { r.run( done ); } );
+
+      for( uint32_t i = 0; i < opt.consumers; ++i ) {
+         consumers.emplace_back( [&, i]() {
+            zmq::socket_t pull( context, ZMQ_PULL );
+            int timeout = 100;
+            pull.setsockopt( ZMQ_RCVTIMEO, &timeout, sizeof(timeout) );
+            pull.setsockopt( ZMQ_LINGER, &linger, sizeof(linger) );
+            pull.connect( addresses[i] );
+            zmq::message_t msg;
+            while( received[i] < opt.frames && !done ) {
+               if( pull.recv(&msg) ) ++received[i];
+            }
+            ++finished;
+         } );
+      }
+
+      const auto start = std::chrono::steady_clock::now();
+      uint64_t bytes = 0;
+      for( uint64_t n = 0; n < opt.frames; ++n ) {
+         const std::string& f = frames[n % frames.size()];
+         zmq::message_t msg( f.size() );
+         memcpy( msg.data(), f.data(), f.size() );
+         producer.send( msg );
+         bytes += f.size();
+      }
+      while( finished < opt.consumers ) std::this_thread::sleep_for( std::chrono::milliseconds(1) );
+      const double secs = std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+
+      done = true;
+      for( auto& t : consumers ) t.join();
+      relay_thread.join();
+
+      const auto s = r.counters();
+      printf( "%llu frames of %zu bytes to %u consumers%s%s in %.3f s\n",
+              static_cast<unsigned long long>(opt.frames), frames[0].size(), opt.consumers,
+              opt.compress ? ", compressed" : "", opt.spool_dir.empty() ? "" : ", spooled", secs );
+      printf( "in:  %.0f frames/s, %.2f MB/s\n", opt.frames / secs, bytes / secs / 1e6 );
+      printf( "out: %.0f frames/s, %.2f MB/s before compression\n",
+              s.frames_out / secs, double(bytes) * opt.consumers / secs / 1e6 );
+   } catch( const std::exception& e ) {
+      done = true;
+      for( auto& t : consumers ) if( t.joinable() ) t.join();
+      std::cerr << "watcher_relay_bench: " << e.what() << std::endl;
+      return 1;
+   }
+   return 0;
+}
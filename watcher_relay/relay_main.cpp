@@ -0,0 +1,119 @@
+/**
+ *  @file
+ *  @copyright eosauthority - free to use and modify - see LICENSE.txt
+ */
+#include <eosio/watcher_relay/relay.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+   std::atomic<bool> done{false};
+
+   void on_signal( int ) { done = true; }
+
+   void usage() {
+      std::cerr <<
+         "Usage: watcher_relay --source <address> --consumer <spec> [--consumer <spec> ...] [options]\n"
+         "\n"
+         "  --source <address>             Address of the watcher_plugin PUSH socket, e.g. ipc:///tmp/watcher\n"
+         "  --source-format <format>       json, binary or zlib, as set by watch-wire-format (default json). A zlib\n"
+         "                                 source reaches consumers without compress=zlib as plain JSON\n"
+         "  --consumer <spec>              PUSH socket binding for one consumer, repeatable:\n"
+         "                                 address[;queue=N][;overflow=block|drop-oldest|drop-newest]\n"
+         "                                 [;types=0,1][;accounts=a,b][;compress=zlib]\n"
+         "  --queue-size <n>               Default frames queued per consumer (default 1000)\n"
+         "  --overflow <policy>            Default overflow policy (default block)\n"
+         "  --heartbeat-interval <ms>      ZMTP heartbeat interval, 0 disables (default 1000)\n"
+         "  --memory-spool-size <n>        Frames kept per consumer while it is detached (default 100000)\n"
+         "  --spool-dir <dir>              Keep every frame in segment files here, disabled if not given\n"
+         "  --spool-segment-size <MiB>     Segment size (default 256)\n"
+         "  --spool-segments <n>           Segments to keep, 0 keeps all (default 0)\n"
+         "  --replay-bind <address>        REP socket answering replay requests from the spool\n"
+         "  --stats-interval <seconds>     Print throughput counters, 0 disables (default 10)\n";
+   }
+}
+
+int main( int argc, char** argv ) {
+   using namespace eosio;
+
+   relay::config cfg;
+   zmq_endpoint::config endpoint_defaults;
+   std::vector<std::string> consumer_specs;
+   uint32_t stats_interval = 10;
+
+   try {
+      for( int i = 1; i < argc; ++i ) {
+         const std::string arg = argv[i];
+         if( arg == "--help" || arg == "-h" ) {
+            usage();
+            return 0;
+         }
+         if( i + 1 >= argc ) throw std::invalid_argument( arg + " needs a value" );
+         const std::string value = argv[++i];
+         if( arg == "--source" ) cfg.source = value;
+         else if( arg == "--source-format" ) cfg.source_encoding = parse_frame_encoding( value );
+         else if( arg == "--consumer" ) consumer_specs.push_back( value );
+         else if( arg == "--queue-size" ) endpoint_defaults.queue_size = std::stoul( value );
+         else if( arg == "--overflow" ) endpoint_defaults.overflow = zmq_endpoint::parse_overflow( value );
+         else if( arg == "--heartbeat-interval" ) endpoint_defaults.heartbeat_ms = std::stoi( value );
+         else if( arg == "--memory-spool-size" ) endpoint_defaults.spool_size = std::stoul( value );
+         else if( arg == "--spool-dir" ) cfg.spool.dir = value;
+         else if( arg == "--spool-segment-size" ) cfg.spool.segment_size = std::stoull( value ) * 1024 * 1024;
+         else if( arg == "--spool-segments" ) cfg.spool.max_segments = std::stoul( value );
+         else if( arg == "--replay-bind" ) cfg.replay_bind = value;
+         else if( arg == "--stats-interval" ) stats_interval = std::stoul( value );
+         else throw std::invalid_argument( "unknown option " + arg );
+      }
+      if( cfg.source.empty() || consumer_specs.empty() ) throw std::invalid_argument( "--source and at least one --consumer are required" );
+      endpoint_defaults.on_attach_change = []( const std::string& bind, bool attached, uint64_t spool_dropped ) {
+         std::cerr << (attached ? "Consumer attached to " : "No consumer attached to ") << bind << std::endl;
+         if( spool_dropped ) std::cerr << "The spool of " << bind << " was full, " << spool_dropped << " oldest messages were dropped" << std::endl;
+      };
+      for( const auto& spec : consumer_specs ) cfg.consumers.push_back( relay::parse_consumer(spec, endpoint_defaults, cfg.source_encoding) );
+   } catch( const std::exception& e ) {
+      std::cerr << "watcher_relay: " << e.what() << "\n\n";
+      usage();
+      return 1;
+   }
+
+   std::signal( SIGINT, on_signal );
+   std::signal( SIGTERM, on_signal );
+
+   try {
+      zmq::context_t context(1);
+      relay r( context, cfg );
+      std::thread reporter;
+      if( stats_interval ) {
+         reporter = std::thread( [&]() {
+            auto last = r.counters();
+            auto last_time = std::chrono::steady_clock::now();
+            while( !done ) {
+               for( uint32_t i = 0; i < stats_interval * 10 && !done; ++i ) std::this_thread::sleep_for( std::chrono::milliseconds(100) );
+               const auto now = std::chrono::steady_clock::now();
+               const auto cur = r.counters();
+               const double secs = std::chrono::duration<double>( now - last_time ).count();
+               fprintf( stderr, "in %.0f frames/s %.2f MB/s, out %.0f frames/s, filtered %llu, malformed %llu\n",
+                        (cur.frames_in - last.frames_in) / secs, (cur.bytes_in - last.bytes_in) / secs / 1e6,
+                        (cur.frames_out - last.frames_out) / secs,
+                        static_cast<unsigned long long>(cur.filtered), static_cast<unsigned long long>(cur.malformed) );
+               last = cur;
+               last_time = now;
+            }
+         } );
+      }
+      r.run( done );
+      if( reporter.joinable() ) reporter.join();
+   } catch( const std::exception& e ) {
+      std::cerr << "watcher_relay: " << e.what() << std::endl;
+      return 1;
+   }
+   return 0;
+}